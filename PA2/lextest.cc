@@ -0,0 +1,208 @@
+//
+// See copyright.h for copyright notice and limitation of liability
+// and disclaimer of warranty provisions.
+//
+#include "copyright.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  lextest.cc
+//
+//  Reads a COOL program from the files named on the command line and
+//  prints the token stream, one token per line, for the parser phase.
+//  With COOL_PACKED_TOKENS set it writes the packed token stream of
+//  ../common/tokens.h instead, one section per file.
+//
+//  With COOL_LEX_JOBS=n the files, and the parts of large files split at
+//  top-level classes (cool_split_input in cool.flex), are scanned by up
+//  to n processes at once, each with its own scanner.  Their output is
+//  written in order, so it is the same as that of one scan except that
+//  a packed stream has a section per part.
+//
+//  This is the course driver with the lexing loop run under a PassTimer
+//  (see ../common/passes.h); link ../common/passes.cc into the lexer.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>      // needed on Linux system
+#include <stdlib.h>
+#include <unistd.h>     // for getopt
+#include <sys/wait.h>
+#include <vector>
+#include "cool-parse.h"	// bison-generated file; defines tokens
+#include "utilities.h"
+#include "../common/passes.h"
+#include "../common/tokens.h"
+
+//
+//  The lexer keeps its own copy of the current line number and takes
+//  input from the global file pointer fin.
+//
+FILE *fin;   // we read from this file
+
+// defined in utilities.cc
+extern void dump_cool_token(ostream& out, int lineno,
+			    int token, YYSTYPE yylval);
+
+extern int cool_yylex();
+extern bool cool_map_input(FILE *f);	// cool.flex
+extern void cool_unmap_input();
+extern int cool_split_input(int parts, size_t min_size, size_t *begin, int *line);
+extern bool cool_scan_part(size_t begin, size_t end);
+YYSTYPE cool_yylval;           // Not compiled with parser, so must define this.
+
+extern int optind;  // used for option processing (man 3 getopt for more info)
+
+//
+//  Option -v sets the lex_verbose flag. The main()
+//  function calls cool_yylex() repeatedly until it returns 0.
+//
+extern int curr_lineno;
+int lex_verbose = 0;
+
+void handle_flags(int argc, char *argv[]);
+
+// Parts smaller than this are not worth a process.
+#define MIN_PART_SIZE (256 * 1024)
+
+//
+// Scans the current input and prints its tokens.
+//
+static void lex_tokens(bool packed, TokenWriter &packed_tokens, char *filename) {
+	int token;
+	if (packed)
+	    packed_tokens.begin(filename);
+	while ((token = cool_yylex()) != 0) {
+	    if (packed)
+		packed_tokens.add(token, curr_lineno, cool_yylval);
+	    else
+		dump_cool_token(cout, curr_lineno, token, cool_yylval);
+	}
+	if (packed)
+	    packed_tokens.write(stdout);
+}
+
+//
+// A file, or a part of one, scanned by a process of its own.
+//
+struct Piece {
+	char *filename;
+	bool whole;		// else [begin, end) of the file, from line
+	size_t begin, end;
+	int line;
+	bool first;		// of its file
+	FILE *out;		// where the process writes
+	pid_t pid;
+};
+
+static FILE *open_input(char *filename) {
+	FILE *f = fopen(filename, "r");
+	if (f == NULL) {
+	    cerr << "Could not open input file " << filename << endl;
+	    exit(1);
+	}
+	return f;
+}
+
+static void start_piece(Piece &p, bool packed) {
+	cout.flush();		// or the child would write it again
+	fflush(stdout);
+	p.out = tmpfile();
+	if (p.out == NULL || (p.pid = fork()) < 0) {
+	    cerr << "Could not start a scanner process" << endl;
+	    exit(1);
+	}
+	if (p.pid == 0) {
+	    TokenWriter packed_tokens;
+	    dup2(fileno(p.out), 1);
+	    fin = open_input(p.filename);
+	    curr_lineno = 1;
+	    if (cool_map_input(fin) && !p.whole) {
+		cool_scan_part(p.begin, p.end);
+		curr_lineno = p.line;
+	    }
+	    lex_tokens(packed, packed_tokens, p.filename);
+	    cout.flush();
+	    fflush(stdout);
+	    _exit(0);
+	}
+}
+
+//
+// Scans the pieces with at most jobs processes running, and copies their
+// output out in order as they finish.
+//
+static void lex_pieces(std::vector<Piece> &pieces, int jobs, bool packed) {
+	char buf[64 * 1024];
+	size_t k, started = 0;
+	for (size_t i = 0; i < pieces.size(); i++) {
+	    while (started < pieces.size() && started < i + jobs)
+		start_piece(pieces[started++], packed);
+	    Piece &p = pieces[i];
+	    int status;
+	    if (waitpid(p.pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		cerr << "Scanner process for " << p.filename << " failed" << endl;
+		exit(1);
+	    }
+	    if (p.first && !packed)
+		cout << "#name \"" << p.filename << "\"" << endl;
+	    cout.flush();
+	    rewind(p.out);
+	    while ((k = fread(buf, 1, sizeof(buf), p.out)) > 0)
+		fwrite(buf, 1, k, stdout);
+	    fclose(p.out);
+	}
+	fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+	bool packed = packed_tokens_requested();
+	TokenWriter packed_tokens;
+	const char *jobs_env = getenv("COOL_LEX_JOBS");
+	int jobs = jobs_env != NULL ? atoi(jobs_env) : 1;
+	std::vector<size_t> begin(jobs > 1 ? jobs + 1 : 2);
+	std::vector<int> line(begin.size());
+
+	handle_flags(argc,argv);
+
+	PassTimer pass("lex");
+	if (jobs > 1) {
+	    std::vector<Piece> pieces;
+	    for (; optind < argc; optind++) {
+		fin = open_input(argv[optind]);
+		cool_map_input(fin);
+		int parts = cool_split_input(jobs, MIN_PART_SIZE, begin.data(), line.data());
+		for (int i = 0; i < parts; i++) {
+		    Piece p;
+		    p.filename = argv[optind];
+		    p.whole = parts == 1;
+		    p.begin = begin[i];
+		    p.end = begin[i + 1];
+		    p.line = line[i];
+		    p.first = i == 0;
+		    pieces.push_back(p);
+		}
+		cool_unmap_input();
+		fclose(fin);
+	    }
+	    lex_pieces(pieces, jobs, packed);
+	    exit(0);
+	}
+	while (optind < argc) {
+	    fin = open_input(argv[optind]);
+
+	    cool_map_input(fin);
+	    curr_lineno = 1;
+
+	    //
+	    // Scan and print all tokens.
+	    //
+	    if (!packed)
+		cout << "#name \"" << argv[optind] << "\"" << endl;
+	    lex_tokens(packed, packed_tokens, argv[optind]);
+	    cool_unmap_input();
+	    fclose(fin);
+	    optind++;
+	}
+	exit(0);
+}
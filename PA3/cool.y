@@ -76,6 +76,10 @@
     
     
     void yyerror(char *s);        /*  defined below; called for each parse error */
+    #undef yylex                  /*  tokens come through cool_next_token in
+                                      parser-phase.cc, which reads either the
+                                      text or the packed token stream */
+    #define yylex cool_next_token
     extern int yylex();           /*  the entry point to the lexer  */
     
     /************************************************************************/
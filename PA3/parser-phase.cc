@@ -0,0 +1,187 @@
+//
+// See copyright.h for copyright notice and limitation of liability
+// and disclaimer of warranty provisions.
+//
+#include "copyright.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  parser-phase.cc
+//
+//  Reads a token stream (text, or the packed stream of ../common/tokens.h)
+//  from standard input, parses it and prints the
+//  AST on standard output, in binary form if COOL_BINARY_AST is set
+//  (see ../common/ast-binary.h).
+//
+//  This is the course driver with parsing and the AST dump run under
+//  PassTimers (see ../common/passes.h); link ../common/passes.cc into
+//  the parser.
+//
+//  COOL_PARSE_WITH picks the parser:
+//    bison   (default) the parser of cool.y
+//    pratt   the hand-written parser of pratt.h, over the token array
+//    diff    both; bison's result is printed, and any difference in the
+//            AST or the number of syntax errors is reported on cerr and
+//            makes the run fail.  When bison runs out of stack (its
+//            recovery from a bad class pushes a state for every token it
+//            drops) the error counts are not compared.
+//
+//  With pratt, COOL_PARSE_JOBS=n parses runs of whole classes on n
+//  threads (pratt_parse_parallel).
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>     // needed on Linux system
+#include <unistd.h>    // for getopt
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "cool-tree.h"
+#include "utilities.h"  // for fatal_error
+#include "cool-parse.h"
+#include "../common/passes.h"
+#include "../common/ast-binary.h"
+#include "../common/tokens.h"
+#include "pratt.h"
+
+//
+// These globals keep everything working.
+//
+FILE *token_file = stdin;		// we read from this file
+extern Classes parse_results;	// list of classes; used for multiple files
+extern Program ast_root;	// the AST produced by the parse
+
+char *curr_filename = "<stdin>";
+
+extern int omerrs;             // a count of lex and parse errors
+
+extern int cool_yyparse();
+extern int cool_yylex();		// reads the text token stream
+extern YYSTYPE cool_yylval;
+extern int curr_lineno;
+
+//
+// The parser takes its tokens from here (see yylex in cool.y): from the
+// packed stream if the lexer wrote one, otherwise from cool_yylex.
+//
+static std::vector<ParserToken> tokens;	// the whole input, for pratt and diff
+static size_t replay = 0;			// next token for bison in diff mode
+static bool replaying = false;
+
+int cool_next_token() {
+  static TokenReader *packed = NULL;
+  static bool checked = false;
+  if (replaying) {
+    const ParserToken &t = tokens[replay < tokens.size() ? replay++ : tokens.size() - 1];
+    curr_lineno = t.line;
+    cool_yylval = t.value;
+    curr_filename = t.filename;
+    return t.token;
+  }
+  if (!checked) {
+    checked = true;
+    if (token_input_is_packed(token_file))
+      packed = new TokenReader(token_file);
+  }
+  if (packed == NULL)
+    return cool_yylex();
+  int token = packed->next(curr_lineno, cool_yylval);
+  if (packed->filename())
+    curr_filename = packed->filename();
+  return token;
+}
+static void read_tokens() {
+  int token;
+  do {
+    token = cool_next_token();
+    ParserToken t;
+    t.token = token;
+    t.line = curr_lineno;
+    t.value = cool_yylval;
+    t.filename = curr_filename;
+    tokens.push_back(t);
+  } while (token != 0);
+}
+
+//
+// Runs bison on the tokens pratt has parsed and compares the results.
+//
+static bool same_as_bison(AstWriter &pratt_ast, int pratt_errors) {
+  int status;
+  replaying = true;
+  {
+    PassTimer pass("parse");
+    status = cool_yyparse();
+  }
+  if (status == 2)		// memory exhausted
+    return true;
+  if (omerrs != pratt_errors) {
+    cerr << "COOL_PARSE_WITH=diff: bison found " << omerrs
+         << " syntax errors, pratt " << pratt_errors << endl;
+    return false;
+  }
+  if (omerrs != 0)
+    return true;
+  AstWriter bison_ast;
+  ast_root->write_binary(bison_ast);
+  std::vector<uint32_t> bison_image, pratt_image;
+  bison_ast.image(bison_image);
+  pratt_ast.image(pratt_image);
+  if (bison_image != pratt_image) {
+    cerr << "COOL_PARSE_WITH=diff: the ASTs of bison and pratt differ" << endl;
+    return false;
+  }
+  return true;
+}
+
+void handle_flags(int argc, char *argv[]);
+
+int main(int argc, char *argv[]) {
+  handle_flags(argc, argv);
+  const char *parser = getenv("COOL_PARSE_WITH");
+  bool pratt = parser != NULL && strcmp(parser, "pratt") == 0;
+  bool diff = parser != NULL && strcmp(parser, "diff") == 0;
+  const char *jobs_env = getenv("COOL_PARSE_JOBS");
+  int jobs = jobs_env != NULL ? atoi(jobs_env) : 1;
+  AstWriter pratt_ast;
+  if (pratt || diff) {
+    int errors;
+    {
+      PassTimer pass("parse.tokens");
+      read_tokens();
+    }
+    {
+      PassTimer pass("parse.pratt");
+      if (pratt && jobs > 1)
+        errors = pratt_parse_parallel(tokens, pratt_ast, jobs);
+      else
+        errors = pratt_parse(tokens, pratt_ast, diff);
+    }
+    if (diff && !same_as_bison(pratt_ast, errors))
+      exit(1);
+  } else {
+    PassTimer pass("parse");
+    cool_yyparse();
+  }
+  if (omerrs != 0) {
+    cerr << "Compilation halted due to lex and parse errors\n";
+    exit(1);
+  }
+  {
+    PassTimer pass("parse.dump");
+    if (pratt && ast_binary_requested()) {
+      pratt_ast.write(cout);	// no tree needed
+      return 0;
+    }
+    if (pratt) {
+      std::vector<uint32_t> image;
+      pratt_ast.image(image);
+      ast_root = read_binary_ast(image);
+    }
+    if (ast_binary_requested())
+      write_binary_ast(ast_root, cout);
+    else
+      ast_root->dump_with_types(cout,0);
+  }
+  return 0;
+}
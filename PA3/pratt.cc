@@ -0,0 +1,636 @@
+//////////////////////////////////////////////////////////////////////
+//
+// pratt.cc
+//
+// The hand-written parser of pratt.h.
+//
+// Line numbers follow YYLLOC_DEFAULT in cool.y: a node gets the line of
+// the first token of the rule that builds it, so the parse functions
+// return the line of the first token of what they parsed.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include "pratt.h"
+#include "utilities.h"
+
+extern int omerrs;
+extern int curr_lineno;
+extern char *curr_filename;
+extern YYSTYPE cool_yylval;
+
+//Binding power of the operators, from the precedence declarations of
+//cool.y.  An operand parsed at level l takes in the infix operators
+//above l.
+enum {
+	LVL_NONE,				//IN: a let body takes everything
+	LVL_ASSIGN,
+	LVL_NOT,
+	LVL_COMPARE,			//nonassoc
+	LVL_ADD,
+	LVL_MUL,
+	LVL_ISVOID,
+	LVL_NEG,
+	LVL_AT,
+	LVL_DOT
+};
+
+static int infix_level(int token) {
+	switch(token) {
+	case LE:
+	case '<':
+	case '=': return LVL_COMPARE;
+	case '+':
+	case '-': return LVL_ADD;
+	case '*':
+	case '/': return LVL_MUL;
+	case '@': return LVL_AT;
+	case '.': return LVL_DOT;
+	default: return LVL_NONE;
+	}
+}
+
+//Unwinds to the innermost recovery point, as bison pops to the innermost
+//state that shifts error.
+struct SyntaxError { };
+//The input ended while skipping to a synchronizing token (YYABORT).
+struct ParseAbort { };
+
+class PrattParser {
+private:
+	const ParserToken* toks;
+	size_t n_toks;
+	ParserToken end_token;	//what is read past the last token
+	size_t pos;
+	AstWriter& w;
+	bool quiet;
+	int errstatus;			//bison's yyerrstatus
+	int errors;
+
+	Symbol self;
+	Symbol object;
+
+	const ParserToken& at(size_t i) { return i < n_toks ? toks[i] : end_token; }
+	int tok() { return at(pos).token; }
+	int lookahead(size_t k) { return at(pos + k).token; }
+	const ParserToken& advance();
+	const ParserToken& expect(int token);
+	void syntax_error();
+	void report(const ParserToken& t);
+	void skip_to(int token);
+
+	void parse_class_recovering();
+	void parse_class();
+	void parse_feature_recovering();
+	void parse_feature();
+	void parse_formal();
+	void parse_args();
+	void parse_let_recovering();
+	void parse_let();
+	int parse_block();
+	int parse_primary();
+	int parse_expr(int level);
+public:
+	PrattParser(const ParserToken* t, size_t n, AstWriter& out, bool q) :
+		toks(t), n_toks(n), pos(0), w(out), quiet(q), errstatus(0), errors(0) {
+		end_token = n > 0 ? t[n - 1] : ParserToken();
+		end_token.token = 0;
+		self = idtable.add_string("self");
+		object = idtable.add_string("Object");
+	}
+	int parse();
+	int parse_classes();
+	int error_count() { return errors; }
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// Tokens and errors
+//
+//////////////////////////////////////////////////////////////////////
+
+const ParserToken& PrattParser::advance() {
+	const ParserToken& t = at(pos);
+	if(pos < n_toks) pos++;
+	if(errstatus) errstatus--;
+	return t;
+}
+
+const ParserToken& PrattParser::expect(int token) {
+	if(tok() != token) syntax_error();
+	return advance();
+}
+
+void PrattParser::report(const ParserToken& t) {
+	errors++;
+	if(quiet) return;
+	curr_lineno = t.line;
+	curr_filename = t.filename;
+	cool_yylval = t.value;
+	cerr << "\"" << curr_filename << "\", line " << curr_lineno << ": " \
+		<< "syntax error" << " at or near ";
+	print_cool_token(t.token);
+	cerr << endl;
+	omerrs++;
+
+	if(omerrs>50) {fprintf(stdout, "More than 50 errors\n"); exit(1);}
+}
+
+//The current token cannot be shifted: yyerrlab.
+void PrattParser::syntax_error() {
+	if(errstatus == 0)
+		report(at(pos));
+	if(errstatus == 3) {
+		if(tok() == 0) throw ParseAbort();
+		pos++;
+	}
+	throw SyntaxError();
+}
+
+//After shifting error: drop tokens until one that can follow it.
+void PrattParser::skip_to(int token) {
+	errstatus = 3;
+	while(tok() != token) {
+		if(tok() == 0) throw ParseAbort();
+		pos++;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Classes and features
+//
+//////////////////////////////////////////////////////////////////////
+
+int PrattParser::parse() {
+	int line = at(pos).line;
+	int n = parse_classes();
+	if(n < 0)
+		return errors;
+	w.list(AST_CLASSES, n);
+	w.node(AST_PROGRAM, line);
+	return errors;
+}
+
+//The class list; returns the number of classes, -1 if the parse aborted.
+int PrattParser::parse_classes() {
+	int n = 0;
+	try {
+		do {
+			parse_class_recovering();
+			n++;
+		} while(tok() != 0);
+	} catch(ParseAbort&) {
+		return -1;
+	}
+	return n;
+}
+
+//class: ... | error class
+void PrattParser::parse_class_recovering() {
+	try {
+		parse_class();
+		return;
+	} catch(SyntaxError&) { }
+	for(;;) {
+		skip_to(CLASS);
+		try {
+			parse_class();
+			errstatus = 0;
+			return;
+		} catch(SyntaxError&) { }
+	}
+}
+
+void PrattParser::parse_class() {
+	int line = expect(CLASS).line;
+	Symbol name = expect(TYPEID).value.symbol;
+	Symbol parent = object;
+	if(tok() == INHERITS) {
+		advance();
+		parent = expect(TYPEID).value.symbol;
+	}
+	expect('{');
+	int n = 0;
+	while(tok() != '}') {
+		parse_feature_recovering();
+		n++;
+	}
+	advance();
+	//the file of the ';', which is where bison reduces the class
+	char* filename = expect(';').filename;
+	w.list(AST_FEATURES, n);
+	w.node(AST_CLASS, line);
+	w.id(name);
+	w.id(parent);
+	w.str(stringtable.add_string(filename));
+}
+
+//feature: ... | error ';'
+void PrattParser::parse_feature_recovering() {
+	try {
+		parse_feature();
+	} catch(SyntaxError&) {
+		skip_to(';');
+		advance();
+	}
+}
+
+void PrattParser::parse_feature() {
+	const ParserToken& id = expect(OBJECTID);
+	if(tok() == '(') {
+		advance();
+		int n = 0;
+		if(tok() != ')') {
+			parse_formal();
+			n++;
+			while(tok() == ',') {
+				advance();
+				parse_formal();
+				n++;
+			}
+		}
+		expect(')');
+		w.list(AST_FORMALS, n);
+		expect(':');
+		Symbol return_type = expect(TYPEID).value.symbol;
+		expect('{');
+		parse_expr(LVL_NONE);
+		expect('}');
+		expect(';');
+		w.node(AST_METHOD, id.line);
+		w.id(id.value.symbol);
+		w.id(return_type);
+		return;
+	}
+	expect(':');
+	Symbol type_decl = expect(TYPEID).value.symbol;
+	if(tok() == ASSIGN) {
+		advance();
+		parse_expr(LVL_NONE);
+	} else {
+		w.node(AST_NO_EXPR, id.line);
+		w.type(NULL);
+	}
+	expect(';');
+	w.node(AST_ATTR, id.line);
+	w.id(id.value.symbol);
+	w.id(type_decl);
+}
+
+void PrattParser::parse_formal() {
+	const ParserToken& id = expect(OBJECTID);
+	expect(':');
+	Symbol type_decl = expect(TYPEID).value.symbol;
+	w.node(AST_FORMAL, id.line);
+	w.id(id.value.symbol);
+	w.id(type_decl);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Expressions
+//
+//////////////////////////////////////////////////////////////////////
+
+//expr_list_comma_parens
+void PrattParser::parse_args() {
+	expect('(');
+	int n = 0;
+	if(tok() != ')') {
+		parse_expr(LVL_NONE);
+		n++;
+		while(tok() == ',') {
+			advance();
+			parse_expr(LVL_NONE);
+			n++;
+		}
+	}
+	expect(')');
+	w.list(AST_EXPRESSIONS, n);
+}
+
+//let_expr: ... | error ',' let_expr
+void PrattParser::parse_let_recovering() {
+	try {
+		parse_let();
+		return;
+	} catch(SyntaxError&) { }
+	skip_to(',');
+	advance();
+	parse_let_recovering();
+	errstatus = 0;
+}
+
+//One binding; the rest nest in its body.
+void PrattParser::parse_let() {
+	const ParserToken& id = expect(OBJECTID);
+	expect(':');
+	Symbol type_decl = expect(TYPEID).value.symbol;
+	if(tok() == ASSIGN) {
+		advance();
+		parse_expr(LVL_NONE);
+	} else {
+		w.node(AST_NO_EXPR, id.line);
+		w.type(NULL);
+	}
+	if(tok() == IN) {
+		advance();
+		parse_expr(LVL_NONE);
+	} else {
+		expect(',');
+		parse_let_recovering();
+	}
+	w.node(AST_LET, id.line);
+	w.id(id.value.symbol);
+	w.id(type_decl);
+	w.type(NULL);
+}
+
+//'{' expr_list_semic '}', where expr_list_semic: ... | error ';'
+int PrattParser::parse_block() {
+	int line = advance().line;
+	int n = 0;
+	do {
+		try {
+			parse_expr(LVL_NONE);
+			expect(';');
+		} catch(SyntaxError&) {
+			skip_to(';');
+			advance();
+		}
+		n++;
+	} while(tok() != '}');
+	advance();
+	w.list(AST_EXPRESSIONS, n);
+	w.node(AST_BLOCK, line);
+	w.type(NULL);
+	return line;
+}
+
+//Everything that does not start with an expression.
+int PrattParser::parse_primary() {
+	const ParserToken& t = at(pos);
+	switch(t.token) {
+	case OBJECTID:
+		if(lookahead(1) == ASSIGN) {
+			advance();
+			advance();
+			parse_expr(LVL_ASSIGN);
+			w.node(AST_ASSIGN, t.line);
+			w.id(t.value.symbol);
+		} else if(lookahead(1) == '(') {
+			advance();
+			w.node(AST_OBJECT, t.line);
+			w.id(self);
+			w.type(NULL);
+			parse_args();
+			w.node(AST_DISPATCH, t.line);
+			w.id(t.value.symbol);
+		} else {
+			advance();
+			w.node(AST_OBJECT, t.line);
+			w.id(t.value.symbol);
+		}
+		break;
+	case INT_CONST:
+		advance();
+		w.node(AST_INT_CONST, t.line);
+		w.integer(t.value.symbol);
+		break;
+	case STR_CONST:
+		advance();
+		w.node(AST_STRING_CONST, t.line);
+		w.str(t.value.symbol);
+		break;
+	case BOOL_CONST:
+		advance();
+		w.node(AST_BOOL_CONST, t.line);
+		w.word(t.value.boolean ? 1 : 0);
+		break;
+	case NEW:
+		advance();
+		w.node(AST_NEW, t.line);
+		w.id(expect(TYPEID).value.symbol);
+		break;
+	case '(':
+		advance();
+		parse_expr(LVL_NONE);
+		expect(')');
+		return t.line;
+	case '{':
+		return parse_block();
+	case IF:
+		advance();
+		parse_expr(LVL_NONE);
+		expect(THEN);
+		parse_expr(LVL_NONE);
+		expect(ELSE);
+		parse_expr(LVL_NONE);
+		expect(FI);
+		w.node(AST_COND, t.line);
+		break;
+	case WHILE:
+		advance();
+		parse_expr(LVL_NONE);
+		expect(LOOP);
+		parse_expr(LVL_NONE);
+		expect(POOL);
+		w.node(AST_LOOP, t.line);
+		break;
+	case CASE: {
+		advance();
+		parse_expr(LVL_NONE);
+		expect(OF);
+		int n = 0;
+		do {
+			const ParserToken& id = expect(OBJECTID);
+			expect(':');
+			Symbol type_decl = expect(TYPEID).value.symbol;
+			expect(DARROW);
+			parse_expr(LVL_NONE);
+			expect(';');
+			w.node(AST_BRANCH, id.line);
+			w.id(id.value.symbol);
+			w.id(type_decl);
+			n++;
+		} while(tok() != ESAC);
+		advance();
+		w.list(AST_CASES, n);
+		w.node(AST_TYPCASE, t.line);
+		break;
+	}
+	case LET:
+		advance();
+		parse_let_recovering();
+		return t.line;
+	case NOT:
+		advance();
+		parse_expr(LVL_NOT);
+		w.node(AST_COMP, t.line);
+		break;
+	case ISVOID:
+		advance();
+		parse_expr(LVL_ISVOID);
+		w.node(AST_ISVOID, t.line);
+		break;
+	case '~':
+		advance();
+		parse_expr(LVL_NEG);
+		w.node(AST_NEG, t.line);
+		break;
+	default:
+		syntax_error();
+	}
+	w.type(NULL);
+	return t.line;
+}
+
+//An expression taking in the infix operators above level.
+int PrattParser::parse_expr(int level) {
+	int line = parse_primary();
+	for(;;) {
+		int op = tok();
+		int op_level = infix_level(op);
+		if(op_level <= level)
+			return line;
+		advance();
+		switch(op) {
+		case '.': {
+			Symbol name = expect(OBJECTID).value.symbol;
+			parse_args();
+			w.node(AST_DISPATCH, line);
+			w.id(name);
+			break;
+		}
+		case '@': {
+			Symbol type_name = expect(TYPEID).value.symbol;
+			expect('.');
+			Symbol name = expect(OBJECTID).value.symbol;
+			parse_args();
+			w.node(AST_STATIC_DISPATCH, line);
+			w.id(type_name);
+			w.id(name);
+			break;
+		}
+		default:
+			parse_expr(op_level);
+			switch(op) {
+			case '+': w.node(AST_PLUS, line); break;
+			case '-': w.node(AST_SUB, line); break;
+			case '*': w.node(AST_MUL, line); break;
+			case '/': w.node(AST_DIVIDE, line); break;
+			case '<': w.node(AST_LT, line); break;
+			case '=': w.node(AST_EQ, line); break;
+			case LE: w.node(AST_LEQ, line); break;
+			}
+		}
+		w.type(NULL);
+		//a < b < c is an error (%nonassoc)
+		if(op_level == LVL_COMPARE && infix_level(tok()) == LVL_COMPARE)
+			syntax_error();
+	}
+}
+
+int pratt_parse(const std::vector<ParserToken>& tokens, AstWriter& out, bool quiet) {
+	PrattParser parser(tokens.data(), tokens.size(), out, quiet);
+	return parser.parse();
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Parsing in parts
+//
+// The token array is cut before top-level CLASS tokens into parts of
+// about equal length, and each part is parsed on a thread of its own
+// into a writer of its own.  The writers share one symbol index, built
+// up front from the tokens, so the parts are joined by concatenation.
+// A syntax error anywhere sends the whole array through the one-thread
+// parse again, which gives bison's messages and recovery across part
+// boundaries.
+//
+//////////////////////////////////////////////////////////////////////
+
+struct PrattPart {
+	const ParserToken* begin;
+	size_t n;
+	AstWriter* out;
+	int classes;
+	int errors;
+};
+
+static void parse_part(PrattPart* part) {
+	PrattParser parser(part->begin, part->n, *part->out, true);
+	part->classes = parser.parse_classes();
+	part->errors = parser.error_count();
+}
+
+int pratt_parse_parallel(const std::vector<ParserToken>& tokens, AstWriter& out, int jobs) {
+	//every symbol a part can write
+	idtable.add_string("self");
+	idtable.add_string("Object");
+	out.add_id(idtable.add_string("self"));
+	out.add_id(idtable.add_string("Object"));
+	char* filename = NULL;
+	std::vector<size_t> cuts(1, 0);
+	size_t step = tokens.size() / (jobs > 1 ? jobs : 1);
+	int braces = 0;
+	for(size_t i = 0; i < tokens.size(); i++) {
+		const ParserToken& t = tokens[i];
+		switch(t.token) {
+		case TYPEID:
+		case OBJECTID: out.add_id(t.value.symbol); break;
+		case STR_CONST: out.add_str(t.value.symbol); break;
+		case INT_CONST: out.add_int(t.value.symbol); break;
+		case '{': braces++; break;
+		case '}': if(braces > 0) braces--; break;
+		case CLASS:
+			if(braces == 0 && (int) cuts.size() < jobs && i >= step * cuts.size())
+				cuts.push_back(i);
+			break;
+		}
+		if(t.filename != filename) {
+			filename = t.filename;
+			out.add_str(stringtable.add_string(filename));
+		}
+	}
+	if(cuts.size() < 2 || tokens.empty())
+		return pratt_parse(tokens, out, false);
+	cuts.push_back(tokens.size());
+
+	size_t n = cuts.size() - 1;
+	std::vector<PrattPart> parts(n);
+	std::vector<AstWriter*> writers(n);
+	std::vector<std::thread> threads;
+	for(size_t i = 0; i < n; i++) {
+		writers[i] = new AstWriter(&out);
+		parts[i].begin = tokens.data() + cuts[i];
+		parts[i].n = cuts[i + 1] - cuts[i];
+		parts[i].out = writers[i];
+		threads.push_back(std::thread(parse_part, &parts[i]));
+	}
+	bool failed = false;
+	int classes = 0;
+	for(size_t i = 0; i < n; i++) {
+		threads[i].join();
+		failed = failed || parts[i].errors != 0 || parts[i].classes < 0;
+		classes += parts[i].classes;
+	}
+	if(failed) {
+		for(size_t i = 0; i < n; i++)
+			delete writers[i];
+		AstWriter again;
+		int errors = pratt_parse(tokens, again, false);
+		out = again;
+		return errors;
+	}
+	for(size_t i = 0; i < n; i++) {
+		out.append(*writers[i]);
+		delete writers[i];
+	}
+	out.list(AST_CLASSES, classes);
+	out.node(AST_PROGRAM, tokens[0].line);
+	return 0;
+}
@@ -0,0 +1,46 @@
+#ifndef PRATT_H_
+#define PRATT_H_
+
+//////////////////////////////////////////////////////////////////////
+//
+// Hand-written parser
+//
+// An alternative to the bison parser of cool.y: recursive descent for
+// classes, features and the bracketed forms, precedence climbing for
+// the operators.  It accepts the same language and builds the same AST,
+// node for node and line for line, but writes it as the postorder
+// records of ../common/ast-binary.h straight into an AstWriter instead
+// of allocating tree nodes; the driver materializes a tree only when
+// it has to print the text dump.
+//
+// Errors are reported like yyerror and recovered from at the points of
+// the error productions of cool.y (classes, features, block elements
+// and let bindings), following bison's rules: no message until three
+// tokens have been shifted after a recovery, yyerrok after a class or
+// a let binding.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include "cool-tree.h"
+#include "cool-parse.h"
+#include "../common/ast-binary.h"
+
+//One token of the input with what the lexer set along with it.
+struct ParserToken {
+	int token;				//0 at the end
+	int line;
+	YYSTYPE value;
+	char* filename;
+};
+
+//Parses tokens, which must end with a 0 token, into out.  Errors are
+//reported on cerr and counted in omerrs unless quiet.  Returns the number
+//of syntax errors.
+int pratt_parse(const std::vector<ParserToken>& tokens, AstWriter& out, bool quiet);
+
+//pratt_parse on up to jobs threads, each parsing a run of whole classes;
+//the result, messages and error count are those of pratt_parse.
+int pratt_parse_parallel(const std::vector<ParserToken>& tokens, AstWriter& out, int jobs);
+
+#endif
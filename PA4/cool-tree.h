@@ -11,6 +11,9 @@
 
 #include "tree.h"
 #include "cool-tree.handcode.h"
+#include "../common/arena.h"
+
+class AstWriter;		// ../common/ast-binary.h
 #include <symtab.h>
 #include <vector>
 
@@ -47,14 +50,18 @@ enum Feature_type {
 };
 
 
+// Nodes of every phylum are allocated in compile_arena (see arena.h).
+
 // define the class for phylum
 // define simple phylum - Program
 typedef class Program_class *Program;
 
 class Program_class : public tree_node {
 public:
+   ARENA_ALLOCATED
    tree_node *copy()		 { return copy_Program(); }
    virtual Program copy_Program() = 0;
+   virtual void write_binary(AstWriter& w) = 0;
 
 #ifdef Program_EXTRAS
    Program_EXTRAS
@@ -67,8 +74,10 @@ typedef class Class__class *Class_;
 
 class Class__class : public tree_node {
 public:
+   ARENA_ALLOCATED
    tree_node *copy()		 { return copy_Class_(); }
    virtual Class_ copy_Class_() = 0;
+   virtual void write_binary(AstWriter& w) = 0;
 
    virtual Symbol get_name() = 0;
    virtual Symbol get_parent() = 0;
@@ -85,8 +94,10 @@ typedef class Feature_class *Feature;
 
 class Feature_class : public tree_node {
 public:
+   ARENA_ALLOCATED
    tree_node *copy()		 { return copy_Feature(); }
    virtual Feature copy_Feature() = 0;
+   virtual void write_binary(AstWriter& w) = 0;
 
    virtual Symbol get_name() = 0;
    virtual Feature_type get_feature_type() = 0;
@@ -102,8 +113,10 @@ typedef class Formal_class *Formal;
 
 class Formal_class : public tree_node {
 public:
+   ARENA_ALLOCATED
    tree_node *copy()		 { return copy_Formal(); }
    virtual Formal copy_Formal() = 0;
+   virtual void write_binary(AstWriter& w) = 0;
 
    virtual Symbol get_name() = 0;
    virtual Symbol get_type_decl() = 0;
@@ -120,8 +133,10 @@ typedef class Expression_class *Expression;
 
 class Expression_class : public tree_node {
 public:
+   ARENA_ALLOCATED
    tree_node *copy()		 { return copy_Expression(); }
    virtual Expression copy_Expression() = 0;
+   virtual void write_binary(AstWriter& w) = 0;
 
    virtual Expr_init get_expr_init() = 0;
 
@@ -136,8 +151,10 @@ typedef class Case_class *Case;
 
 class Case_class : public tree_node {
 public:
+   ARENA_ALLOCATED
    tree_node *copy()		 { return copy_Case(); }
    virtual Case copy_Case() = 0;
+   virtual void write_binary(AstWriter& w) = 0;
 
 #ifdef Case_EXTRAS
    Case_EXTRAS
@@ -184,6 +201,7 @@ public:
    }
    Program copy_Program();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 
 #ifdef Program_SHARED_EXTRAS
@@ -211,6 +229,7 @@ public:
    }
    Class_ copy_Class_();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Symbol get_name() { return name; }
    Symbol get_parent() { return parent; }
@@ -241,6 +260,7 @@ public:
    }
    Feature copy_Feature();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Symbol get_name() { return name; }
    Formals get_formals() { return formals; }
@@ -271,6 +291,7 @@ public:
    }
    Feature copy_Feature();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Symbol get_name() { return name; }
    Symbol get_type_decl() { return type_decl; }
@@ -298,6 +319,7 @@ public:
    }
    Formal copy_Formal();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Symbol get_name() { return name; }
    Symbol get_type_decl() { return type_decl; }
@@ -325,6 +347,7 @@ public:
    }
    Case copy_Case();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
    Symbol get_name() { return name; }
    Symbol get_type_decl() { return type_decl; }
    Expression get_expr() { return expr; }
@@ -350,6 +373,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_ASSIGN; }
    Symbol get_name() { return name; }
@@ -380,6 +404,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_STATIC_DISPATCH; }
    Expression get_expr() { return expr; }
@@ -412,6 +437,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_DISPATCH; }
    Expression get_expr() { return expr; }
@@ -442,6 +468,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_COND; }
    Expression get_pred() { return pred; }
@@ -470,6 +497,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_LOOP; }
    Expression get_pred() { return pred; }
@@ -496,6 +524,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_TYPCASE; }
    Expression get_expr() { return expr; }
@@ -521,6 +550,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_BLOCK; }
    Expressions get_body() { return body; }
@@ -550,6 +580,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_LET; }
    Symbol get_identifier() { return identifier; }
@@ -579,6 +610,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_PLUS; }
    Expression get_e1() { return e1; }
@@ -606,6 +638,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_SUB; }
    Expression get_e1() { return e1; }
@@ -632,6 +665,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_MUL; }
    Expression get_e1() { return e1; }
@@ -659,6 +693,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_DIVIDE; }
    Expression get_e1() { return e1; }
@@ -684,6 +719,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_NEG; }
    Expression get_e1() { return e1; }
@@ -710,6 +746,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_LT; }
    Expression get_e1() { return e1; }
@@ -737,6 +774,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_EQ; }
    Expression get_e1() { return e1; }
@@ -764,6 +802,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_LEQ; }
    Expression get_e1() { return e1; }
@@ -788,6 +827,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_COMP; }
    Expression get_e1() { return e1; }
@@ -811,6 +851,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_INT_CONST; }
 
@@ -833,6 +874,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_BOOL_CONST; }
 
@@ -856,6 +898,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_STRING_CONST; }
 
@@ -879,6 +922,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_NEW; }
    Symbol get_type_name() { return type_name; }
@@ -902,6 +946,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_ISVOID; }
    Expression get_e1() { return e1; }
@@ -924,6 +969,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_NO_EXPR; }
 
@@ -947,6 +993,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
    Expr_init get_expr_init() { return EXPR_OBJECT; }
    Symbol get_name() { return name; }
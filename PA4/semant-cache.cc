@@ -0,0 +1,150 @@
+//////////////////////////////////////////////////////////////////////
+//
+// semant-cache.cc
+//
+// The cache file of semant-cache.h.  Layout (words, host byte order):
+//
+//    magic (2 words), version, number of strings, size of the string
+//    section, number of classes
+//    string section    every name in the file (../common/symbol-section.h)
+//    class records     name, body fingerprint (2 words), number of uses,
+//                      then name and interface fingerprint (2 words) of
+//                      each, number of types, then each type as 1 + its
+//                      string or 0 for none
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "semant-cache.h"
+#include "../common/symbol-section.h"
+
+#define SEMANT_CACHE_MAGIC     "\177COOLSEM"
+#define SEMANT_CACHE_VERSION   2
+#define HEADER_WORDS           6
+
+const CachedClass* SemantCache::find(Symbol name) const {
+	std::map<Symbol, CachedClass>::const_iterator it = classes.find(name);
+	return it == classes.end() ? NULL : &it->second;
+}
+
+//
+// Saving
+//
+
+static uint32_t string_of(Symbol s, std::map<Symbol, uint32_t>& index, std::vector<uint32_t>& strings,
+		uint32_t& n) {
+	std::map<Symbol, uint32_t>::iterator it = index.find(s);
+	if(it != index.end())
+		return it->second;
+	put_symbol_entry(strings, s->get_string(), s->get_len());
+	return index[s] = n++;
+}
+
+static void put_fingerprint(std::vector<uint32_t>& out, uint64_t f) {
+	out.push_back((uint32_t) f);
+	out.push_back((uint32_t) (f >> 32));
+}
+
+bool SemantCache::save(const char* path) const {
+	std::map<Symbol, uint32_t> index;
+	std::vector<uint32_t> strings, records;
+	uint32_t n = 0;
+	for(std::map<Symbol, CachedClass>::const_iterator it = classes.begin(); it != classes.end(); ++it) {
+		const CachedClass& c = it->second;
+		records.push_back(string_of(it->first, index, strings, n));
+		put_fingerprint(records, c.body);
+		records.push_back(c.uses.size());
+		for(size_t i = 0; i < c.uses.size(); i++) {
+			records.push_back(string_of(c.uses[i].first, index, strings, n));
+			put_fingerprint(records, c.uses[i].second);
+		}
+		records.push_back(c.types.size());
+		for(size_t i = 0; i < c.types.size(); i++)
+			records.push_back(c.types[i] == NULL ? 0 : string_of(c.types[i], index, strings, n) + 1);
+	}
+
+	uint32_t header[HEADER_WORDS];
+	memcpy(header, SEMANT_CACHE_MAGIC, 8);
+	header[2] = SEMANT_CACHE_VERSION;
+	header[3] = n;
+	header[4] = strings.size();
+	header[5] = classes.size();
+
+	//write a new file and rename it, so that a reader never sees half of one
+	std::string tmp = std::string(path) + ".tmp";
+	FILE* f = fopen(tmp.c_str(), "wb");
+	if(f == NULL) return false;
+	bool ok = fwrite(header, sizeof(header), 1, f) == 1 &&
+			fwrite(strings.data(), sizeof(uint32_t), strings.size(), f) == strings.size() &&
+			fwrite(records.data(), sizeof(uint32_t), records.size(), f) == records.size();
+	ok = fclose(f) == 0 && ok;
+	return ok && rename(tmp.c_str(), path) == 0;
+}
+
+//
+// Loading
+//
+
+bool SemantCache::load(const char* path) {
+	classes.clear();
+	FILE* f = fopen(path, "rb");
+	if(f == NULL) return false;
+	std::vector<uint32_t> words;
+	uint32_t buf[4096];
+	size_t n;
+	while((n = fread(buf, sizeof(uint32_t), 4096, f)) > 0)
+		words.insert(words.end(), buf, buf + n);
+	fclose(f);
+
+	if(words.size() < HEADER_WORDS || memcmp(words.data(), SEMANT_CACHE_MAGIC, 8) != 0 ||
+			words[2] != SEMANT_CACHE_VERSION)
+		return false;
+	const uint32_t* p = words.data() + HEADER_WORDS;
+	const uint32_t* end = words.data() + words.size();
+	if((size_t) (end - p) < words[4]) return false;
+	const uint32_t* strings_end = p + words[4];
+	std::vector<Symbol> strings;
+	for(uint32_t i = 0; i < words[3]; i++) {
+		uint32_t len;
+		char* s = get_symbol_entry(p, strings_end, len);
+		if(s == NULL) return false;
+		strings.push_back(idtable.add_string(s, len));
+	}
+	p = strings_end;
+
+	#define TAKE(w) do { if(p == end) goto malformed; (w) = *p++; } while(0)
+	for(uint32_t i = 0; i < words[5]; i++) {
+		CachedClass c;
+		uint32_t name, lo, hi, count;
+		TAKE(name);
+		TAKE(lo);
+		TAKE(hi);
+		c.body = lo | (uint64_t) hi << 32;
+		TAKE(count);
+		for(uint32_t j = 0; j < count; j++) {
+			uint32_t use;
+			TAKE(use);
+			TAKE(lo);
+			TAKE(hi);
+			if(use >= strings.size()) goto malformed;
+			c.uses.push_back(std::make_pair(strings[use], lo | (uint64_t) hi << 32));
+		}
+		TAKE(count);
+		for(uint32_t j = 0; j < count; j++) {
+			uint32_t type;
+			TAKE(type);
+			if(type > strings.size()) goto malformed;
+			c.types.push_back(type == 0 ? NULL : strings[type - 1]);
+		}
+		if(name >= strings.size()) goto malformed;
+		classes[strings[name]] = c;
+	}
+	#undef TAKE
+	return true;
+
+malformed:
+	classes.clear();
+	return false;
+}
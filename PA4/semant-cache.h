@@ -0,0 +1,53 @@
+#ifndef SEMANT_CACHE_H_
+#define SEMANT_CACHE_H_
+
+//////////////////////////////////////////////////////////////////////
+//
+// Incremental type checking
+//
+// When COOL_SEMANT_CACHE names a file, semant keeps in it, for every
+// class of the last program it accepted:
+//
+//    - the fingerprint of the class's own tree (its binary AST records,
+//      ../common/ast-binary.h, before type checking), with its lines
+//      counted from the class's first, so that lines added or removed
+//      above the class do not make it checked again,
+//    - the classes that checking its features looked up in the class
+//      table (its ancestors, the receivers of its dispatches, the types
+//      it news, its case branches, ...), each with the fingerprint of
+//      its interface: parent, attribute types and method signatures,
+//    - the types it gave to its expressions, in preorder.
+//
+// A class whose tree and whose looked-up interfaces are unchanged gets
+// its types from the cache instead of being checked again.  The checks
+// of the class hierarchy always run.  The file is rewritten only when
+// the program has no errors and some class was checked again.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+#include <map>
+#include <utility>
+#include <vector>
+#include "stringtab.h"
+
+struct CachedClass {
+	uint64_t body;
+	std::vector<std::pair<Symbol, uint64_t> > uses;
+	std::vector<Symbol> types;		//NULL for none
+};
+
+class SemantCache {
+private:
+	std::map<Symbol, CachedClass> classes;
+public:
+	//false, with the cache empty, if path is missing or not a cache file.
+	bool load(const char* path);
+	bool save(const char* path) const;
+
+	const CachedClass* find(Symbol name) const;
+	size_t size() const { return classes.size(); }
+	void add(Symbol name, const CachedClass& c) { classes[name] = c; }
+};
+
+#endif
@@ -0,0 +1,53 @@
+//
+// See copyright.h for copyright notice and limitation of liability
+// and disclaimer of warranty provisions.
+//
+#include "copyright.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  semant-phase.cc
+//
+//  Reads the AST dump of the parser from standard input, checks it and
+//  prints the annotated AST on standard output.  Both the input and the
+//  output may be in the binary form of ../common/ast-binary.h; the output
+//  is when COOL_BINARY_AST is set.
+//
+//  This is the course driver with reading and dumping the AST run under
+//  PassTimers; semant() times its own steps (see ../common/passes.h).
+//  Link ../common/passes.cc into the semantic analyzer.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include "cool-tree.h"
+#include "../common/passes.h"
+#include "../common/ast-binary.h"
+
+extern Program ast_root;      // root of the abstract syntax tree
+FILE *ast_file = stdin;       // we read the AST from standard input
+extern int ast_yyparse(void); // entry point to the AST parser
+
+int cool_yydebug;     // not used, but needed to link with handle_flags
+char *curr_filename;
+
+void handle_flags(int argc, char *argv[]);
+
+int main(int argc, char *argv[]) {
+  handle_flags(argc,argv);
+  {
+    PassTimer pass("semant.read_ast");
+    if (ast_input_is_binary(ast_file))
+      ast_root = read_binary_ast(ast_file);
+    else
+      ast_yyparse();
+  }
+  ast_root->semant();
+  {
+    PassTimer pass("semant.dump");
+    if (ast_binary_requested())
+      write_binary_ast(ast_root, cout);
+    else
+      ast_root->dump_with_types(cout,0);
+  }
+}
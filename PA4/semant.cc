@@ -6,6 +6,9 @@
 #include "semant.h"
 #include "utilities.h"
 #include "list.h"
+#include "../common/passes.h"
+#include "../common/ast-binary.h"
+#include "../common/fingerprint.h"
 
 extern int semant_debug;
 extern char *curr_filename;
@@ -119,7 +122,8 @@ CompRes ClassTable::check_method_redefinition (Class_ c, method_class *method, L
 ClassTable::ClassTable(Classes classes) :
 		semant_errors(0),
 		error_stream(cerr),
-		classMap (new SymbolTable<Symbol, ClassDecl>()){
+		classMap (arena_new<SymbolTable<Symbol, ClassDecl> >()),
+		uses(NULL) {
 	classMap->enterscope();
 	install_basic_classes();
 
@@ -128,7 +132,7 @@ ClassTable::ClassTable(Classes classes) :
 		Class_ c = classes->nth(i);
 		if(c->get_name() == SELF_TYPE) {
 			semant_error(c) << "SELF_TYPE cannot be used as class name." << std::endl;
-		} else if(classMap->lookup(c->get_name())) {
+		} else if(lookup_decl(c->get_name())) {
 			semant_error(c) << "Class " << c->get_name()->get_string()
 					<< " was previously defined." << std::endl;
 		} else {
@@ -144,12 +148,12 @@ ClassTable::ClassTable(Classes classes) :
 			if (parent == Int || parent == Bool || parent == Str || parent == SELF_TYPE) {
 				semant_error(c) << "Class " << c->get_name()->get_string()
 						<< " cannot inherit from class " << parent->get_string() << std::endl;
-			} else if(classMap->lookup(parent) == NULL) {
+			} else if(lookup_decl(parent) == NULL) {
 				semant_error(c) << "Class " <<  c->get_name()->get_string() << " inherits from class "
 						<< parent->get_string() << " that is not defined." << std::endl;
 			} else {
-				ClassDecl* parentDecl = classMap->lookup(parent);
-				parentDecl->children = new List<Entry>(c->get_name(), parentDecl->children);
+				ClassDecl* parentDecl = lookup_decl(parent);
+				parentDecl->children = arena_new<List<Entry> >(c->get_name(), parentDecl->children);
 			}
 		}
 	}
@@ -158,9 +162,9 @@ ClassTable::ClassTable(Classes classes) :
 	if(!errors()) {
 		for(int i = classes->first(); classes->more(i); i = classes->next(i)) {
 			Symbol c = classes->nth(i)->get_name();
-			for(Symbol d = classMap->lookup(c)->parent;
+			for(Symbol d = lookup_decl(c)->parent;
 					d != Object;
-					d = classMap->lookup(d)->parent) {
+					d = lookup_decl(d)->parent) {
 				if(d == c) {
 					semant_error(classes->nth(i)) << "Class " << c->get_string()
 							<< " is involved in an inheritance cycle." << std::endl;
@@ -172,7 +176,7 @@ ClassTable::ClassTable(Classes classes) :
 
 	//Detect Main and main()
 	if(!errors()) {
-		ClassDecl *mainDecl = classMap->lookup(Main);
+		ClassDecl *mainDecl = lookup_decl(Main);
 		if(mainDecl == NULL) {
 			semant_error() << "Class Main is not defined." << std::endl;
 		} else if (mainDecl->methodTable->lookup(main_meth) == NULL) {
@@ -185,20 +189,20 @@ ClassTable::ClassTable(Classes classes) :
 		for(int i = classes->first(); classes->more(i); i = classes->next(i)) {
 			Class_ c = classes->nth(i);
 		    Features fs = c->get_features();
-			ClassDecl* decl = classMap->lookup(c->get_name());
+			ClassDecl* decl = lookup_decl(c->get_name());
 
 		    for(int j = fs->first(); fs->more(j); j = fs->next(j)) {
 		    	Feature f = fs->nth(j);
 		    	if(f->get_feature_type() == FEATURE_ATTR) {
 		    		attr_class *attr = dynamic_cast<attr_class*>(f);
-		    		for(Symbol d = decl->parent; d != No_class; d = classMap->lookup(d)->parent) {
-		    			if(classMap->lookup(d)->attrTable->lookup(attr->get_name()) != NULL) {
+		    		for(Symbol d = decl->parent; d != No_class; d = lookup_decl(d)->parent) {
+		    			if(lookup_decl(d)->attrTable->lookup(attr->get_name()) != NULL) {
 							semant_error(c) << "Attribute " << attr->get_name()->get_string()
 									<< " is an attribute of an inherited class." << std::endl;
 						}
 					}
 		    		Symbol attrType = attr->get_type_decl();
-		    		if(classMap->lookup(attrType) == NULL) {
+		    		if(lookup_decl(attrType) == NULL) {
 		    			semant_error(c) << "Attribute " << attr->get_name()->get_string()
 		    					<< " is of undefined type " << attrType->get_string()
 								<< ". " << std::endl;
@@ -207,24 +211,24 @@ ClassTable::ClassTable(Classes classes) :
 		    		method_class *method = dynamic_cast<method_class*>(f);
 
 		    		//check validity of signiture (undefined types). Note that return type can be SELF_TYPE
-    				List<Entry>* sig = classMap->lookup(c->get_name())->methodTable->lookup(method->get_name());
+    				List<Entry>* sig = lookup_decl(c->get_name())->methodTable->lookup(method->get_name());
     				while(sig != NULL && sig->tl() != NULL) {
-    					if(classMap->lookup(sig->hd()) == NULL) {
+    					if(lookup_decl(sig->hd()) == NULL) {
     						semant_error(c) << "Method " << method->get_name()->get_string()
     								<< " contains an undefined type " << sig->hd()->get_string()
 									<< "." << std::endl;
     					}
     					sig = sig->tl();
     				}
-    				if(sig->hd() != SELF_TYPE && classMap->lookup(sig->hd()) == NULL) {
+    				if(sig->hd() != SELF_TYPE && lookup_decl(sig->hd()) == NULL) {
     				    	semant_error(c) << "Method " << method->get_name()->get_string()
     				    			<< " returns to an undefined type " << sig->hd()->get_string()
 									<< "." << std::endl;
     				}
 
-		    		for(Symbol d = decl->parent; d != No_class; d = classMap->lookup(d)->parent) {
-		    			if(classMap->lookup(d)->methodTable->lookup(method->get_name()) != NULL) {
-		    				List<Entry>* sigd = classMap->lookup(d)->methodTable->lookup(method->get_name());
+		    		for(Symbol d = decl->parent; d != No_class; d = lookup_decl(d)->parent) {
+		    			if(lookup_decl(d)->methodTable->lookup(method->get_name()) != NULL) {
+		    				List<Entry>* sigd = lookup_decl(d)->methodTable->lookup(method->get_name());
 		    				auto comp = check_method_redefinition(c, method, sigd);
 		    				if(comp == COMP_DIFF_LENGTH) {
 		    					semant_error(c) << "Method " << method->get_name()->get_string()
@@ -246,27 +250,27 @@ ClassTable::ClassTable(Classes classes) :
 
 
 Symbol ClassTable::find_symbol_type(Class_ c, Symbol s) {
-	ClassDecl *decl = classMap->lookup(c->get_name());
+	ClassDecl *decl = find_class(c->get_name());
 	Symbol res = decl->attrTable->lookup(s);
 	if(res != NULL) {
 		return res;
 	} else if(decl->parent == No_class) { //Error should be reported!
 		return No_type;
 	} else {
-		Class_ parentC = classMap->lookup(decl->parent)->body;
+		Class_ parentC = find_class(decl->parent)->body;
 		return find_symbol_type(parentC, s);
 	}
 }
 
 List<Entry>* ClassTable::find_method_signature(Class_ c, Symbol f) {
-	ClassDecl *decl = classMap->lookup(c->get_name());
+	ClassDecl *decl = find_class(c->get_name());
 	List<Entry>* res = decl->methodTable->lookup(f);
 	if(res != NULL) {
 		return res;
 	} else if(decl->parent == No_class) {
 		return NULL;
 	} else {
-		Class_ parentC = classMap->lookup(decl->parent)->body;
+		Class_ parentC = find_class(decl->parent)->body;
 		return find_method_signature(parentC, f);
 	}
 }
@@ -274,13 +278,13 @@ List<Entry>* ClassTable::find_method_signature(Class_ c, Symbol f) {
 //Add a class to the class table. Return the ClassDecl for this class.
 ClassDecl* ClassTable::add_new_class_basic(Class_ c) {
 
-    ClassDecl* decl = new ClassDecl();
+    ClassDecl* decl = arena_new<ClassDecl>();
     decl->body = c;
     decl->parent = c->get_parent();
     decl->children = NULL;
 
-    decl->attrTable = new SymbolTable<Symbol, Entry>();
-    decl->methodTable = new SymbolTable<Symbol, List<Entry> >();
+    decl->attrTable = arena_new<SymbolTable<Symbol, Entry> >();
+    decl->methodTable = arena_new<SymbolTable<Symbol, List<Entry> > >();
     decl->attrTable->enterscope();
     decl->methodTable->enterscope();
 
@@ -311,7 +315,7 @@ ClassDecl* ClassTable::add_new_class_basic(Class_ c) {
 							<< " is multiply defined in class " << c->get_name()->get_string()
 							<< std::endl;
     		}
-    		List<Entry>* l = new List<Entry>(method->get_return_type());
+    		List<Entry>* l = arena_new<List<Entry> >(method->get_return_type());
     		Formals formals = method->get_formals();
 
     		//enterscope here because a formal parameter hides attribute of the same name.
@@ -328,7 +332,7 @@ ClassDecl* ClassTable::add_new_class_basic(Class_ c) {
     			} else {
     				decl->attrTable->addid(name, type_decl);
     			}
-    			l = new List<Entry>(type_decl, l);
+    			l = arena_new<List<Entry> >(type_decl, l);
     		}
 
     		//Exit scope here because formal parameters previously added should be discarded.
@@ -338,6 +342,7 @@ ClassDecl* ClassTable::add_new_class_basic(Class_ c) {
     	}
     }
     classMap->addid(c->get_name(), decl);
+    decls[c->get_name()] = decl;
     return decl;
 }
 
@@ -447,10 +452,10 @@ void ClassTable::install_basic_classes() {
     add_new_class_basic(Bool_class);
     add_new_class_basic(Str_class);
     //Add childrens for Object clas.
-    objDecl->children = new List<Entry>(IO,
-    		new List<Entry>(Int,
-					new List<Entry>(Bool,
-							new List<Entry>(Str))));
+    objDecl->children = arena_new<List<Entry> >(IO,
+    		arena_new<List<Entry> >(Int,
+					arena_new<List<Entry> >(Bool,
+							arena_new<List<Entry> >(Str))));
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -494,7 +499,7 @@ bool ClassTable::subtype(Class_ c, Symbol s1, Symbol s2) {
 	} else if (s2 == SELF_TYPE || s1 == Object) {
 		return false;
 	} else {
-		return subtype(c, classMap->lookup(s1)->parent, s2);
+		return subtype(c, find_class(s1)->parent, s2);
 	}
 }
 
@@ -509,7 +514,7 @@ Symbol ClassTable::lub(Class_ c, Symbol s1, Symbol s2) {
 	} else if (s2 == SELF_TYPE) {
 		return lub(c, s1, c->get_name());
 	} else {
-		return lub(c, s1, classMap->lookup(s2)->parent);
+		return lub(c, s1, find_class(s2)->parent);
 	}
 }
 
@@ -532,9 +537,14 @@ Symbol ClassTable::lub(Class_ c, Symbol s1, Symbol s2) {
 
 void program_class::semant()
 {
+    PassTimer pass("semant");
     initialize_constants();
 
-    ClassTable *classtable = new ClassTable(classes);
+    ClassTable *classtable;
+    {
+    	PassTimer pass("semant.class_table");
+    	classtable = new ClassTable(classes);
+    }
 
     if (classtable->errors()) {
     	std::cerr << "Compilation halted due to static semantic errors." << endl;
@@ -542,53 +552,256 @@ void program_class::semant()
     }
 
     //Type checking
-    for(int i = classes->first(); classes->more(i); i = classes->next(i)) {
-    	Class_ c = classes->nth(i);
-	    Features fs = c->get_features();
-
-		SymbolTable<Symbol, Entry>* attrTable =
-				classtable->get_class_map()->lookup(c->get_name())->attrTable;
-		attrTable->enterscope();
-		attrTable->addid(self, SELF_TYPE);
-
-	    for(int j = fs->first(); fs->more(j); j = fs->next(j)) {
-	    	Feature f = fs->nth(j);
-	    	if(f->get_feature_type() == FEATURE_ATTR) {
-	    		attr_class *attr = dynamic_cast<attr_class*>(f);
-	    		Symbol exprType = classtable->check_type(c, attr->get_init());
-
-	    		if(exprType == No_type || classtable->subtype(c, exprType, attr->get_type_decl()))
-	    			continue;
-	    		else {
-	    			classtable->semant_error(c) << "Attribute " << attr->get_name()
-	    					<< " of declared type " << attr->get_type_decl()->get_string()
-							<< " in Class " << c->get_name() << " is initialized with "
-							<< "expresion of type" << exprType->get_string() << "."
-							<< std::endl;
-	    		}
-	    	} else if (f->get_feature_type() == FEATURE_METHOD) {
-	    		method_class *method = dynamic_cast<method_class*>(f);
-	    		Formals formals = method->get_formals();
-	    		for(int k = formals->first(); formals->more(k); k = formals->next(k)) {
-	    			Formal formal = formals->nth(k);
-	    			attrTable->addid(formal->get_name(), formal->get_type_decl());
-	    		}
-	    		Symbol return_type = method->get_return_type();
-	    		Symbol actual_type = classtable->check_type(c, method->get_expr());
-	    		if(!classtable->subtype(c, actual_type, return_type)) {
-	    			classtable->semant_error(c) << "In method " << method->get_name()
-	    					<< ", type of expression " << actual_type->get_string()
-							<< " does not conform to declared return type "
-							<< return_type->get_string() << "." << std::endl;
-	    		}
-	    	}
-	    }
-		attrTable->exitscope();
+    const char* cache_path = getenv("COOL_SEMANT_CACHE");
+    SemantCache old_cache, new_cache;
+    bool rechecked = false;
+    if(cache_path) {
+    	PassTimer pass("semant.load_cache");
+    	old_cache.load(cache_path);
+    }
+    {
+    	PassTimer type_check_pass("semant.type_check");
+    	for(int i = classes->first(); classes->more(i); i = classes->next(i)) {
+    		if(cache_path)
+    			rechecked |= classtable->check_class(classes->nth(i), old_cache, new_cache);
+    		else
+    			classtable->check_class(classes->nth(i));
+    	}
     }
     if(classtable->errors()) {
     	std::cerr << "Compilation halted due to static semantic errors." << endl;
     	exit(1);
     }
+    if(cache_path && (rechecked || new_cache.size() != old_cache.size())) {
+    	PassTimer pass("semant.save_cache");
+    	new_cache.save(cache_path);
+    }
+}
+
+void ClassTable::check_class(Class_ c) {
+	Features fs = c->get_features();
+
+	SymbolTable<Symbol, Entry>* attrTable = find_class(c->get_name())->attrTable;
+	attrTable->enterscope();
+	attrTable->addid(self, SELF_TYPE);
+
+	for(int j = fs->first(); fs->more(j); j = fs->next(j)) {
+		Feature f = fs->nth(j);
+		if(f->get_feature_type() == FEATURE_ATTR) {
+			attr_class *attr = dynamic_cast<attr_class*>(f);
+			Symbol exprType = check_type(c, attr->get_init());
+
+			if(exprType == No_type || subtype(c, exprType, attr->get_type_decl()))
+				continue;
+			else {
+				semant_error(c) << "Attribute " << attr->get_name()
+						<< " of declared type " << attr->get_type_decl()->get_string()
+						<< " in Class " << c->get_name() << " is initialized with "
+						<< "expresion of type" << exprType->get_string() << "."
+						<< std::endl;
+			}
+		} else if (f->get_feature_type() == FEATURE_METHOD) {
+			method_class *method = dynamic_cast<method_class*>(f);
+			Formals formals = method->get_formals();
+			for(int k = formals->first(); formals->more(k); k = formals->next(k)) {
+				Formal formal = formals->nth(k);
+				attrTable->addid(formal->get_name(), formal->get_type_decl());
+			}
+			Symbol return_type = method->get_return_type();
+			Symbol actual_type = check_type(c, method->get_expr());
+			if(!subtype(c, actual_type, return_type)) {
+				semant_error(c) << "In method " << method->get_name()
+						<< ", type of expression " << actual_type->get_string()
+						<< " does not conform to declared return type "
+						<< return_type->get_string() << "." << std::endl;
+			}
+		}
+	}
+	attrTable->exitscope();
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Incremental type checking (semant-cache.h)
+//
+//////////////////////////////////////////////////////////////////////
+
+//The class table entry of name; the lookup is recorded while a class is
+//checked for the cache.
+ClassDecl* ClassTable::find_class(Symbol name) {
+	if(uses != NULL)
+		uses->insert(name);
+	return lookup_decl(name);
+}
+
+static uint64_t fingerprint_symbol(Symbol s, uint64_t h) {
+	return s == NULL ? fingerprint("", 1, h) : fingerprint(s->get_string(), s->get_len() + 1, h);
+}
+
+//Fingerprint of what checking another class can learn about class name:
+//its parent, its attributes and its method signatures; 0 if there is no
+//such class.
+uint64_t ClassTable::interface_fingerprint(Symbol name) {
+	std::map<Symbol, uint64_t>::iterator it = interfaces.find(name);
+	if(it != interfaces.end())
+		return it->second;
+	ClassDecl* decl = lookup_decl(name);
+	uint64_t h = 0;
+	if(decl != NULL) {
+		h = fingerprint_symbol(decl->parent, FINGERPRINT_INIT);
+		Features fs = decl->body->get_features();
+		for(int i = fs->first(); fs->more(i); i = fs->next(i)) {
+			Feature f = fs->nth(i);
+			if(f->get_feature_type() == FEATURE_ATTR) {
+				attr_class *attr = dynamic_cast<attr_class*>(f);
+				h = fingerprint_symbol(attr->get_type_decl(), fingerprint_symbol(attr->get_name(), h));
+			} else {
+				method_class *method = dynamic_cast<method_class*>(f);
+				h = fingerprint_symbol(method->get_name(), fingerprint("(", 1, h));
+				Formals formals = method->get_formals();
+				for(int k = formals->first(); formals->more(k); k = formals->next(k))
+					h = fingerprint_symbol(formals->nth(k)->get_type_decl(), h);
+				h = fingerprint_symbol(method->get_return_type(), fingerprint(")", 1, h));
+			}
+		}
+	}
+	return interfaces[name] = h;
+}
+
+
+//The expressions of e in preorder.
+static void expressions(Expression e, std::vector<Expression>& out) {
+	out.push_back(e);
+	switch(e->get_expr_init()) {
+	case EXPR_ASSIGN:
+		expressions(dynamic_cast<assign_class*>(e)->get_expr(), out);
+		break;
+	case EXPR_DISPATCH: {
+		dispatch_class* d = dynamic_cast<dispatch_class*>(e);
+		expressions(d->get_expr(), out);
+		Expressions actual = d->get_actual();
+		for(int i = actual->first(); actual->more(i); i = actual->next(i))
+			expressions(actual->nth(i), out);
+		break;
+	}
+	case EXPR_STATIC_DISPATCH: {
+		static_dispatch_class* d = dynamic_cast<static_dispatch_class*>(e);
+		expressions(d->get_expr(), out);
+		Expressions actual = d->get_actual();
+		for(int i = actual->first(); actual->more(i); i = actual->next(i))
+			expressions(actual->nth(i), out);
+		break;
+	}
+	case EXPR_LET:
+		expressions(dynamic_cast<let_class*>(e)->get_init(), out);
+		expressions(dynamic_cast<let_class*>(e)->get_body(), out);
+		break;
+	case EXPR_COND:
+		expressions(dynamic_cast<cond_class*>(e)->get_pred(), out);
+		expressions(dynamic_cast<cond_class*>(e)->get_then_exp(), out);
+		expressions(dynamic_cast<cond_class*>(e)->get_else_exp(), out);
+		break;
+	case EXPR_LOOP:
+		expressions(dynamic_cast<loop_class*>(e)->get_pred(), out);
+		expressions(dynamic_cast<loop_class*>(e)->get_body(), out);
+		break;
+	case EXPR_BLOCK: {
+		Expressions body = dynamic_cast<block_class*>(e)->get_body();
+		for(int i = body->first(); body->more(i); i = body->next(i))
+			expressions(body->nth(i), out);
+		break;
+	}
+	case EXPR_TYPCASE: {
+		typcase_class* t = dynamic_cast<typcase_class*>(e);
+		expressions(t->get_expr(), out);
+		Cases cases = t->get_cases();
+		for(int i = cases->first(); cases->more(i); i = cases->next(i))
+			expressions(dynamic_cast<branch_class*>(cases->nth(i))->get_expr(), out);
+		break;
+	}
+	case EXPR_PLUS:
+		expressions(dynamic_cast<plus_class*>(e)->get_e1(), out);
+		expressions(dynamic_cast<plus_class*>(e)->get_e2(), out);
+		break;
+	case EXPR_SUB:
+		expressions(dynamic_cast<sub_class*>(e)->get_e1(), out);
+		expressions(dynamic_cast<sub_class*>(e)->get_e2(), out);
+		break;
+	case EXPR_MUL:
+		expressions(dynamic_cast<mul_class*>(e)->get_e1(), out);
+		expressions(dynamic_cast<mul_class*>(e)->get_e2(), out);
+		break;
+	case EXPR_DIVIDE:
+		expressions(dynamic_cast<divide_class*>(e)->get_e1(), out);
+		expressions(dynamic_cast<divide_class*>(e)->get_e2(), out);
+		break;
+	case EXPR_LT:
+		expressions(dynamic_cast<lt_class*>(e)->get_e1(), out);
+		expressions(dynamic_cast<lt_class*>(e)->get_e2(), out);
+		break;
+	case EXPR_EQ:
+		expressions(dynamic_cast<eq_class*>(e)->get_e1(), out);
+		expressions(dynamic_cast<eq_class*>(e)->get_e2(), out);
+		break;
+	case EXPR_LEQ:
+		expressions(dynamic_cast<leq_class*>(e)->get_e1(), out);
+		expressions(dynamic_cast<leq_class*>(e)->get_e2(), out);
+		break;
+	case EXPR_NEG:
+		expressions(dynamic_cast<neg_class*>(e)->get_e1(), out);
+		break;
+	case EXPR_COMP:
+		expressions(dynamic_cast<comp_class*>(e)->get_e1(), out);
+		break;
+	case EXPR_ISVOID:
+		expressions(dynamic_cast<isvoid_class*>(e)->get_e1(), out);
+		break;
+	default:
+		break;
+	}
+}
+
+static void expressions(Class_ c, std::vector<Expression>& out) {
+	Features fs = c->get_features();
+	for(int i = fs->first(); fs->more(i); i = fs->next(i)) {
+		Feature f = fs->nth(i);
+		if(f->get_feature_type() == FEATURE_ATTR)
+			expressions(dynamic_cast<attr_class*>(f)->get_init(), out);
+		else
+			expressions(dynamic_cast<method_class*>(f)->get_expr(), out);
+	}
+}
+
+bool ClassTable::check_class(Class_ c, const SemantCache& old, SemantCache& next) {
+	CachedClass entry;
+	entry.body = class_records_fingerprint(c);		//before checking sets the types
+	std::vector<Expression> exprs;
+	expressions(c, exprs);
+
+	const CachedClass* hit = old.find(c->get_name());
+	bool same = hit != NULL && hit->body == entry.body && hit->types.size() == exprs.size();
+	for(size_t i = 0; same && i < hit->uses.size(); i++)
+		same = interface_fingerprint(hit->uses[i].first) == hit->uses[i].second;
+	if(same) {
+		for(size_t i = 0; i < exprs.size(); i++)
+			exprs[i]->set_type(hit->types[i]);
+		next.add(c->get_name(), *hit);
+		return false;
+	}
+
+	std::set<Symbol> used;
+	int before = semant_errors;
+	uses = &used;
+	check_class(c);
+	uses = NULL;
+	if(semant_errors != before)
+		return true;
+	for(std::set<Symbol>::iterator it = used.begin(); it != used.end(); ++it)
+		entry.uses.push_back(std::make_pair(*it, interface_fingerprint(*it)));
+	for(size_t i = 0; i < exprs.size(); i++)
+		entry.types.push_back(exprs[i]->get_type());
+	next.add(c->get_name(), entry);
+	return true;
 }
 
 static bool contain(List<Entry>* types, Symbol type) {
@@ -631,7 +844,7 @@ Symbol ClassTable::check_type( Class_ c, Expression expr) {
 
 		Symbol t1 = check_type(c, expr1);
 		Symbol t = (t1 == SELF_TYPE) ? c->get_name() : t1;
-		Class_ m = classMap->lookup(t)->body;
+		Class_ m = find_class(t)->body;
 
 		List<Entry>* sig = find_method_signature(m, name);
 		if(sig == NULL) {
@@ -667,7 +880,7 @@ Symbol ClassTable::check_type( Class_ c, Expression expr) {
 
 		Symbol t1 = check_type(c, expr1);
 
-		if(!classMap->lookup(type_name)) {
+		if(!find_class(type_name)) {
 			semant_error(c) << "In static dispatch, class " <<  type_name->get_string()
 								<< " is not defined." << std::endl;
 			expr->set_type(Object);
@@ -676,7 +889,7 @@ Symbol ClassTable::check_type( Class_ c, Expression expr) {
 					<< " is not a subtype of " << type_name->get_string() << std::endl;
 			expr->set_type(Object);
 		} else {
-			Class_ m = classMap->lookup(type_name)->body;
+			Class_ m = find_class(type_name)->body;
 			List<Entry>* sig = find_method_signature(m, name);
 			if(sig == NULL) {
 				semant_error(c) << "Function " << name->get_string() << " is not defined for type "
@@ -709,7 +922,7 @@ Symbol ClassTable::check_type( Class_ c, Expression expr) {
 		Expression body = expr_let->get_body();
 
 		Symbol t1 = check_type(c, init);
-		SymbolTable<Symbol, Entry>* attrTable = classMap->lookup(c->get_name())->attrTable;
+		SymbolTable<Symbol, Entry>* attrTable = find_class(c->get_name())->attrTable;
 		attrTable->enterscope();
 
 		if(identifier == self) {
@@ -774,7 +987,7 @@ Symbol ClassTable::check_type( Class_ c, Expression expr) {
 		Expression expr1 = expr_case->get_expr();
 		check_type(c, expr1);
 		Cases cases = expr_case->get_cases();
-		SymbolTable<Symbol, Entry>* attrTable = classMap->lookup(c->get_name())->attrTable;
+		SymbolTable<Symbol, Entry>* attrTable = find_class(c->get_name())->attrTable;
 		List<Entry>* return_types = NULL;
 		List<Entry>* decl_types = NULL;
 		for(int i = cases->first(); cases->more(i); i = cases->next(i)) {
@@ -795,8 +1008,8 @@ Symbol ClassTable::check_type( Class_ c, Expression expr) {
 			} else {
 				attrTable->enterscope();
 				attrTable->addid(branch->get_name(), branch->get_type_decl());
-				return_types = new List<Entry>(check_type(c, branch->get_expr()), return_types);
-				decl_types = new List<Entry>(branch->get_type_decl(), decl_types);
+				return_types = arena_new<List<Entry> >(check_type(c, branch->get_expr()), return_types);
+				decl_types = arena_new<List<Entry> >(branch->get_type_decl(), decl_types);
 				attrTable->exitscope();
 			}
 		}
@@ -936,7 +1149,7 @@ Symbol ClassTable::check_type( Class_ c, Expression expr) {
 
 		if(type_name == SELF_TYPE)
 			expr->set_type(SELF_TYPE);
-		else if(classMap->lookup(type_name))
+		else if(find_class(type_name))
 			expr->set_type(type_name);
 		else {//a class that does not exist is used here.
 			expr->set_type(Object);
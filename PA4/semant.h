@@ -7,6 +7,9 @@
 #include "stringtab.h"
 #include "symtab.h"
 #include "list.h"
+#include <map>
+#include <set>
+#include "semant-cache.h"
 
 #define TRUE 1
 #define FALSE 0
@@ -41,8 +44,17 @@ private:
   int semant_errors;
   std::ostream& error_stream;
   SymbolTable<Symbol, ClassDecl>* classMap;
+  std::map<Symbol, ClassDecl*> decls;	//classMap's entries, looked up in log time
+  std::set<Symbol>* uses;		//classes looked up while checking a class, if recorded
+  std::map<Symbol, uint64_t> interfaces;	//fingerprints of the classes' interfaces
 
   void install_basic_classes();
+  ClassDecl* lookup_decl(Symbol name) {
+	  std::map<Symbol, ClassDecl*>::iterator it = decls.find(name);
+	  return it == decls.end() ? NULL : it->second;
+  }
+  ClassDecl* find_class(Symbol name);
+  uint64_t interface_fingerprint(Symbol name);
 
 public:
   ClassTable(Classes);
@@ -64,6 +76,13 @@ public:
 
   bool subtype(Class_, Symbol, Symbol);
   Symbol lub(Class_, Symbol, Symbol);
+
+  //Type checks the features of a class.
+  void check_class(Class_ c);
+  //check_class, or the types of the class from old if nothing it depends
+  //on has changed (see semant-cache.h); records the class in next.  True
+  //if the class was checked.
+  bool check_class(Class_ c, const SemantCache& old, SemantCache& next);
 };
 
 
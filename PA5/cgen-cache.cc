@@ -0,0 +1,189 @@
+//////////////////////////////////////////////////////////////////////
+//
+// cgen-cache.cc
+//
+// The cache file of cgen-cache.h.  Layout (words, host byte order):
+//
+//    magic (2 words), version, number of strings, size of the string
+//    section, number of classes
+//    string section    every name and text in the file
+//                      (../common/symbol-section.h)
+//    class records     name, tree fingerprint (2 words), number of
+//                      facts, then kind, class (1 + its string or 0),
+//                      name and value (2 words) of each, number of
+//                      constants, then each constant's string, the
+//                      strings of the initializer and the methods, and
+//                      the number of statistics, then the name and value
+//                      (2 words) of each
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "cgen-cache.h"
+#include "../common/symbol-section.h"
+
+#define CGEN_CACHE_MAGIC       "\177COOLGEN"
+#define HEADER_WORDS           6
+
+const CachedCode* CgenCache::find(Symbol name) const {
+	std::map<Symbol, CachedCode>::const_iterator it = classes.find(name);
+	return it == classes.end() ? NULL : &it->second;
+}
+
+//
+// Saving
+//
+
+static uint32_t string_of(const std::string& s, std::map<std::string, uint32_t>& index,
+		std::vector<uint32_t>& strings, uint32_t& n) {
+	std::map<std::string, uint32_t>::iterator it = index.find(s);
+	if(it != index.end())
+		return it->second;
+	put_symbol_entry(strings, s.data(), s.size());
+	return index[s] = n++;
+}
+
+static uint32_t string_of(Symbol s, std::map<std::string, uint32_t>& index,
+		std::vector<uint32_t>& strings, uint32_t& n) {
+	return string_of(std::string(s->get_string(), s->get_len()), index, strings, n);
+}
+
+static void put_fingerprint(std::vector<uint32_t>& out, uint64_t f) {
+	out.push_back((uint32_t) f);
+	out.push_back((uint32_t) (f >> 32));
+}
+
+bool CgenCache::save(const char* path) const {
+	std::map<std::string, uint32_t> index;
+	std::vector<uint32_t> strings, records;
+	uint32_t n = 0;
+	for(std::map<Symbol, CachedCode>::const_iterator it = classes.begin(); it != classes.end(); ++it) {
+		const CachedCode& c = it->second;
+		records.push_back(string_of(it->first, index, strings, n));
+		put_fingerprint(records, c.tree);
+		records.push_back(c.facts.size());
+		for(size_t i = 0; i < c.facts.size(); i++) {
+			const CgenFact& f = c.facts[i];
+			records.push_back(f.kind);
+			records.push_back(f.cls == NULL ? 0 : string_of(f.cls, index, strings, n) + 1);
+			records.push_back(f.name == NULL ? 0 : string_of(f.name, index, strings, n) + 1);
+			put_fingerprint(records, f.value);
+		}
+		records.push_back(c.constants.size());
+		for(size_t i = 0; i < c.constants.size(); i++)
+			records.push_back(string_of(c.constants[i], index, strings, n));
+		records.push_back(string_of(c.init, index, strings, n));
+		records.push_back(string_of(c.methods, index, strings, n));
+		records.push_back(c.statistics.size());
+		for(size_t i = 0; i < c.statistics.size(); i++) {
+			records.push_back(string_of(c.statistics[i].first, index, strings, n));
+			put_fingerprint(records, c.statistics[i].second);
+		}
+	}
+
+	uint32_t header[HEADER_WORDS];
+	memcpy(header, CGEN_CACHE_MAGIC, 8);
+	header[2] = CGEN_CACHE_VERSION;
+	header[3] = n;
+	header[4] = strings.size();
+	header[5] = classes.size();
+
+	//write a new file and rename it, so that a reader never sees half of one
+	std::string tmp = std::string(path) + ".tmp";
+	FILE* f = fopen(tmp.c_str(), "wb");
+	if(f == NULL) return false;
+	bool ok = fwrite(header, sizeof(header), 1, f) == 1 &&
+			fwrite(strings.data(), sizeof(uint32_t), strings.size(), f) == strings.size() &&
+			fwrite(records.data(), sizeof(uint32_t), records.size(), f) == records.size();
+	ok = fclose(f) == 0 && ok;
+	return ok && rename(tmp.c_str(), path) == 0;
+}
+
+//
+// Loading
+//
+
+bool CgenCache::load(const char* path) {
+	classes.clear();
+	FILE* f = fopen(path, "rb");
+	if(f == NULL) return false;
+	std::vector<uint32_t> words;
+	uint32_t buf[4096];
+	size_t n;
+	while((n = fread(buf, sizeof(uint32_t), 4096, f)) > 0)
+		words.insert(words.end(), buf, buf + n);
+	fclose(f);
+
+	if(words.size() < HEADER_WORDS || memcmp(words.data(), CGEN_CACHE_MAGIC, 8) != 0 ||
+			words[2] != CGEN_CACHE_VERSION)
+		return false;
+	const uint32_t* p = words.data() + HEADER_WORDS;
+	const uint32_t* end = words.data() + words.size();
+	if((size_t) (end - p) < words[4]) return false;
+	const uint32_t* strings_end = p + words[4];
+	std::vector<std::string> strings;
+	for(uint32_t i = 0; i < words[3]; i++) {
+		uint32_t len;
+		char* s = get_symbol_entry(p, strings_end, len);
+		if(s == NULL) return false;
+		strings.push_back(std::string(s, len));
+	}
+	p = strings_end;
+
+	#define TAKE(w) do { if(p == end) goto malformed; (w) = *p++; } while(0)
+	#define SYMBOL(i) idtable.add_string((char*) strings[i].c_str(), strings[i].size())
+	for(uint32_t i = 0; i < words[5]; i++) {
+		CachedCode c;
+		uint32_t name, lo, hi, count, init, methods;
+		TAKE(name);
+		TAKE(lo);
+		TAKE(hi);
+		c.tree = lo | (uint64_t) hi << 32;
+		TAKE(count);
+		for(uint32_t j = 0; j < count; j++) {
+			CgenFact fact;
+			uint32_t cls, fname;
+			TAKE(fact.kind);
+			TAKE(cls);
+			TAKE(fname);
+			TAKE(lo);
+			TAKE(hi);
+			if(cls > strings.size() || fname > strings.size()) goto malformed;
+			fact.cls = cls == 0 ? NULL : SYMBOL(cls - 1);
+			fact.name = fname == 0 ? NULL : SYMBOL(fname - 1);
+			fact.value = lo | (uint64_t) hi << 32;
+			c.facts.push_back(fact);
+		}
+		TAKE(count);
+		for(uint32_t j = 0; j < count; j++) {
+			uint32_t constant;
+			TAKE(constant);
+			if(constant >= strings.size()) goto malformed;
+			c.constants.push_back(strings[constant]);
+		}
+		TAKE(init);
+		TAKE(methods);
+		if(name >= strings.size() || init >= strings.size() || methods >= strings.size())
+			goto malformed;
+		c.init = strings[init];
+		c.methods = strings[methods];
+		TAKE(count);
+		for(uint32_t j = 0; j < count; j++) {
+			uint32_t statistic;
+			TAKE(statistic);
+			TAKE(lo);
+			TAKE(hi);
+			if(statistic >= strings.size()) goto malformed;
+			c.statistics.push_back(std::make_pair(strings[statistic], (long) (lo | (uint64_t) hi << 32)));
+		}
+		classes[SYMBOL(name)] = c;
+	}
+	#undef SYMBOL
+	#undef TAKE
+	return true;
+
+malformed:
+	classes.clear();
+	return false;
+}
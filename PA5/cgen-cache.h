@@ -0,0 +1,95 @@
+#ifndef CGEN_CACHE_H_
+#define CGEN_CACHE_H_
+
+//////////////////////////////////////////////////////////////////////
+//
+// Incremental code generation
+//
+// When COOL_CGEN_CACHE names a file, cgen keeps in it the code of the
+// initializer and of the methods of every class of the last program it
+// compiled, with what that code was made from:
+//
+//    - the fingerprint of the class's typed tree, with its lines counted
+//      from the class's first record (../common/ast-binary.h),
+//    - the facts about other classes it used: the offsets of its
+//      attributes, the dispatch table offset of every method it calls,
+//      the body it inlined, or not, at each call, the method each call
+//      in tail position runs, if known, the class each method it codes
+//      or calls first appears in, with register arguments, the receiver
+//      guessed at each speculative call, the methods it copies from
+//      other classes, the method each call on self runs in such a copy,
+//      and, if it has a case, the tags and parents of all classes,
+//    - the constants and the aborts on void it refers to, by their text,
+//      with the line of an abort counted from the line of the class it
+//      is in (which may be a class it inlines or copies from); in the
+//      cached code a reference is a marker (\001<n>\001 for the nth one).
+//      Inlined and copied bodies are fingerprinted with their lines
+//      counted the same way,
+//    - what coding it added to the cgen statistics (../common/passes.h).
+//
+// A class whose tree is unchanged and whose facts still hold gets its
+// code from the cache, with the markers replaced by the labels the
+// constants have in this program, so a class that only moved in its file
+// is not coded again either; the other classes are.  The statistics of a
+// class from the cache are added again, so they are those of a full run.
+// The labels inside the code of a class are named after the class
+// (<Class>_L<n>), so code from the cache does not clash with new code.
+//
+// Link cgen-cache.cc into the code generator.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "stringtab.h"
+
+//Bumped whenever the code cgen makes for the same tree and facts changes.
+#define CGEN_CACHE_VERSION     11
+
+enum CgenFactKind {
+	FACT_ATTR,				//cls.name is at offset value in cls
+	FACT_METHOD,			//cls.name is at offset value in cls's dispatch table
+	FACT_CLASSES,			//value is classes_fingerprint()
+	FACT_INLINE,			//value is inline_target(cls, name, false).print
+	FACT_INLINE_STATIC,		//value is inline_target(cls, name, true).print
+	FACT_BOUND,				//value is class_print(bound_class(cls, name, false))
+	FACT_BOUND_STATIC,		//value is class_print(bound_class(cls, name, true))
+	FACT_ROOT,				//value is class_print(root_class(cls, name))
+	FACT_GUESS,				//value is speculation(cls, name).print
+	FACT_CLONES,			//value is cls's clones_print
+	FACT_SLOT				//value is class_print(slot_class(cls, name))
+};
+
+struct CgenFact {
+	uint32_t kind;
+	Symbol cls;				//NULL for FACT_CLASSES
+	Symbol name;
+	uint64_t value;
+};
+
+struct CachedCode {
+	uint64_t tree;
+	std::vector<CgenFact> facts;
+	std::vector<std::string> constants;	//'S' or 'I', then the text, or an abort stub key
+	std::string init;
+	std::string methods;
+	std::vector<std::pair<std::string, long> > statistics;	//what the code adds to them, by name
+};
+
+class CgenCache {
+private:
+	std::map<Symbol, CachedCode> classes;
+public:
+	//false, with the cache empty, if path is missing or not a cache file.
+	bool load(const char* path);
+	bool save(const char* path) const;
+
+	const CachedCode* find(Symbol name) const;
+	void add(Symbol name, const CachedCode& c) { classes[name] = c; }
+	size_t size() const { return classes.size(); }
+};
+
+#endif
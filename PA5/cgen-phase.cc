@@ -0,0 +1,77 @@
+//
+// See copyright.h for copyright notice and limitation of liability
+// and disclaimer of warranty provisions.
+//
+#include "copyright.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  cgen-phase.cc
+//
+//  Reads the annotated AST (text dump or the binary form of
+//  ../common/ast-binary.h) from standard input and writes MIPS assembly
+//  to the file given with -o (or derived from the first file name), or
+//  to standard output.
+//
+//  This is the course driver with reading the AST run under a PassTimer;
+//  cgen() times its own steps (see ../common/passes.h).  Link
+//  ../common/passes.cc into the code generator.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "cool-tree.h"
+#include "cgen_gc.h"
+#include "cgen.h"
+#include "../common/passes.h"
+#include "../common/ast-binary.h"
+
+extern char *out_filename;     // set by handle_flags (-o)
+extern int optind;            // used for option processing (man 3 getopt for more info)
+extern Program ast_root;      // root of the abstract syntax tree
+FILE *ast_file = stdin;       // we read the AST from standard input
+extern int ast_yyparse(void); // entry point to the AST parser
+
+int cool_yydebug;     // not used, but needed to link with handle_flags
+char *curr_filename;
+
+void handle_flags(int argc, char *argv[]);
+
+int main(int argc, char *argv[]) {
+  handle_flags(argc,argv);
+
+  if (!out_filename && optind < argc) {   // no -o option
+      char *dot = strrchr(argv[optind], '.');
+      if (dot) *dot = '\0'; // strip off file extension
+      out_filename = new char[strlen(argv[optind])+8];
+      strcpy(out_filename, argv[optind]);
+      strcat(out_filename, ".s");
+  }
+
+  //
+  // Don't touch the output file until we know that earlier phases of the
+  // compiler have succeeded.
+  //
+  // the basic classes first, as in cool-server, so that both number the
+  // constants alike
+  cgen_prepare();
+  {
+    PassTimer pass("cgen.read_ast");
+    if (ast_input_is_binary(ast_file))
+      ast_root = read_binary_ast(ast_file);
+    else
+      ast_yyparse();
+  }
+
+  if (out_filename) {
+      ofstream s(out_filename);
+      if (!s) {
+	  cerr << "Cannot open output file " << out_filename << endl;
+	  exit(1);
+      }
+      ast_root->cgen(s);
+  } else {
+      ast_root->cgen(cout);
+  }
+}
@@ -24,7 +24,13 @@
 
 #include "cgen.h"
 #include "cgen_gc.h"
+#include "../common/passes.h"
+#include "../common/ast-binary.h"
+#include "../common/fingerprint.h"
 #include <cassert>
+#include <algorithm>
+#include <iterator>
+#include <fstream>
 #include <sstream>
 
 extern void emit_string_constant(ostream& str, char *s);
@@ -37,9 +43,6 @@ const int MY_BOOL_TAG = 3;
 const int MY_STRING_TAG = 4;
 const int NO_ANCESTOR = -1;
 
-int Expression_class::i_label = 0;
-int let_class::let_layer = 0;
-int typcase_class::case_layer = 0;
 //
 // Three symbols from the semantic analyzer (semant.cc) are used.
 // If e : No_type, then no code is generated for e.
@@ -123,6 +126,118 @@ static char *gc_collect_names[] =
   { "_NoGC_Collect", "_GenGC_Collect", "_ScnGC_Collect" };
 
 
+//
+// The basic classes as trees, in the order No_class, SELF_TYPE, prim_slot,
+// Object, IO, Int, Bool, String.  They are the same for every program, so
+// a process that compiles many (cool-server.cc) builds them once, before
+// it forks a child for each compilation.
+//
+static Class_ basic_classes[8];
+
+static void build_basic_classes()
+{
+// The tree package uses these globals to annotate the classes built below.
+  //curr_lineno  = 0;
+  Symbol filename = stringtable.add_string("<basic class>");
+
+  basic_classes[0] = class_(No_class,No_class,nil_Features(),filename);
+  basic_classes[1] = class_(SELF_TYPE,No_class,nil_Features(),filename);
+  basic_classes[2] = class_(prim_slot,No_class,nil_Features(),filename);
+
+// 
+// The Object class has no parent class. Its methods are
+//        cool_abort() : Object    aborts the program
+//        type_name() : Str        returns a string representation of class name
+//        copy() : SELF_TYPE       returns a copy of the object
+//
+// There is no need for method bodies in the basic classes---these
+// are already built in to the runtime system.
+//
+  basic_classes[3] =
+    class_(Object, 
+	   No_class,
+	   append_Features(
+           append_Features(
+           single_Features(method(cool_abort, nil_Formals(), Object, no_expr())),
+           single_Features(method(type_name, nil_Formals(), Str, no_expr()))),
+           single_Features(method(copy, nil_Formals(), SELF_TYPE, no_expr()))),
+	   filename);
+
+// 
+// The IO class inherits from Object. Its methods are
+//        out_string(Str) : SELF_TYPE          writes a string to the output
+//        out_int(Int) : SELF_TYPE               "    an int    "  "     "
+//        in_string() : Str                    reads a string from the input
+//        in_int() : Int                         "   an int     "  "     "
+//
+  basic_classes[4] =
+     class_(IO, 
+            Object,
+            append_Features(
+            append_Features(
+            append_Features(
+            single_Features(method(out_string, single_Formals(formal(arg, Str)),
+                        SELF_TYPE, no_expr())),
+            single_Features(method(out_int, single_Formals(formal(arg, Int)),
+                        SELF_TYPE, no_expr()))),
+            single_Features(method(in_string, nil_Formals(), Str, no_expr()))),
+            single_Features(method(in_int, nil_Formals(), Int, no_expr()))),
+	   filename);
+//
+// The Int class has no methods and only a single attribute, the
+// "val" for the integer. 
+//
+  basic_classes[5] =
+     class_(Int, 
+	    Object,
+            single_Features(attr(val, prim_slot, no_expr())),
+	    filename);
+
+//
+// Bool also has only the "val" slot.
+//
+  basic_classes[6] =
+      class_(Bool, Object, single_Features(attr(val, prim_slot, no_expr())),filename);
+
+//
+// The class Str has a number of slots and operations:
+//       val                                  ???
+//       str_field                            the string itself
+//       length() : Int                       length of the string
+//       concat(arg: Str) : Str               string concatenation
+//       substr(arg: Int, arg2: Int): Str     substring
+//       
+  basic_classes[7] =
+      class_(Str, 
+	     Object,
+             append_Features(
+             append_Features(
+             append_Features(
+             append_Features(
+             single_Features(attr(val, Int, no_expr())),
+            single_Features(attr(str_field, prim_slot, no_expr()))),
+            single_Features(method(length, nil_Formals(), Int, no_expr()))),
+            single_Features(method(concat, 
+				   single_Formals(formal(arg, Str)),
+				   Str, 
+				   no_expr()))),
+	    single_Features(method(substr, 
+				   append_Formals(single_Formals(formal(arg, Int)), 
+						  single_Formals(formal(arg2, Int))),
+				   Str, 
+				   no_expr()))),
+	     filename);
+}
+
+void cgen_prepare()
+{
+  static bool prepared = false;
+  if (prepared) return;
+  prepared = true;
+  initialize_constants();
+  build_basic_classes();
+}
+
 //  BoolConst is a class that implements code generation for operations
 //  on the two booleans, which are given global names here.
 BoolConst falsebool(FALSE);
@@ -144,9 +259,10 @@ BoolConst truebool(TRUE);
 void program_class::cgen(ostream &os) 
 {
   // spim wants comments to start with '#'
+  PassTimer pass("cgen");
   os << "# start of generated code\n";
 
-  initialize_constants();
+  cgen_prepare();
   CgenClassTable *codegen_classtable = new CgenClassTable(classes,os);
 
   os << "\n# end of generated code\n";
@@ -245,6 +361,9 @@ static void emit_jal(char *address,ostream &s)
 static void emit_return(ostream& s)
 { s << RET << endl; }
 
+static void emit_jr(char *address, ostream& s)
+{ s << JR << address << endl; }
+
 static void emit_gc_assign(ostream& s)
 { s << JAL << "_GenGC_Assign" << endl; }
 
@@ -254,8 +373,14 @@ static void emit_disptable_ref(Symbol sym, ostream& s)
 static void emit_init_ref(Symbol sym, ostream& s)
 { s << sym << CLASSINIT_SUFFIX; }
 
+//the class whose code is being emitted; its labels are named after it,
+//and numbered by it (CgenNode::new_label), also in methods inlined from
+//other classes.
+static Symbol label_class;
+static CgenNode* label_node;
+
 static void emit_label_ref(int l, ostream &s)
-{ s << "label" << l; }
+{ s << label_class << "_L" << l; }
 
 static void emit_protobj_ref(Symbol sym, ostream& s)
 { s << sym << PROTOBJ_SUFFIX; }
@@ -263,8 +388,13 @@ static void emit_protobj_ref(Symbol sym, ostream& s)
 static void emit_method_ref(Symbol classname, Symbol methodname, ostream& s)
 { s << classname << METHOD_SEP << methodname; }
 
+//true while the code emitted can not run: after a tail call, up to the
+//next label
+static bool unreachable = false;
+
 static void emit_label_def(int l, ostream &s)
 {
+  unreachable = false;
   emit_label_ref(l,s);
   s << ":" << endl;
 }
@@ -330,10 +460,29 @@ static void emit_branch(int l, ostream& s)
 //
 // Push a register on the stack. The stack grows towards smaller addresses.
 //
+// The frame of a method has frame_size slots for the values its code
+// keeps, allocated by the prologue, and frame_depth of them in use.
+// frame_temps counts the words pushed below them, the arguments of the
+// calls being made.  All are 0 after the prologue.
+//
+static int frame_size = 0;
+static int frame_depth = 0;
+static int frame_temps = 0;
+
 static void emit_push(char *reg, ostream& str)
 {
   emit_store(reg,0,SP,str);
   emit_addiu(SP,SP,-4,str);
+  frame_temps++;
+}
+
+//
+// Pop words off the stack.
+//
+static void emit_pop(int words, ostream& str)
+{
+  emit_addiu(SP,SP,4 * words,str);
+  frame_temps -= words;
 }
 
 //
@@ -358,7 +507,7 @@ static void emit_test_collector(ostream &s)
   emit_move(ACC, SP, s); // stack end
   emit_move(A1, ZERO, s); // allocate nothing
   s << JAL << gc_collect_names[cgen_Memmgr] << endl;
-  emit_addiu(SP,SP,4,s);
+  emit_pop(1,s);
   emit_load(ACC,0,SP,s);
 }
 
@@ -369,6 +518,151 @@ static void emit_gc_check(char *source, ostream &s)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+//
+// Recording code for the cache (cgen-cache.h)
+//
+// While the code of a class is made for the cache, what it depends on
+// is noted in it, and constants are referred to by markers.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+static CachedCode* recording = NULL;
+static std::map<std::string, int> recorded_constants;  // markers of recording, by key
+
+static void note_fact(CgenFactKind kind, Symbol cls, Symbol name, uint64_t value)
+{
+  if (recording == NULL) return;
+  CgenFact f = { kind, cls, name, value };
+  recording->facts.push_back(f);
+}
+
+// Adds n to the statistic name, which the cache keeps with the code.
+static void class_statistic(const std::string& name, long n)
+{
+  pass_statistic(name.c_str(), n);
+  if (recording) recording->statistics.push_back(std::make_pair(name, n));
+}
+
+// key is 'S' or 'I' and the text of the constant, or an abort stub key.
+static void emit_constant_marker(const std::string& key, ostream& s)
+{
+  int n;
+  std::map<std::string, int>::iterator it = recorded_constants.find(key);
+  if (it != recorded_constants.end())
+    n = it->second;
+  else {
+    n = recorded_constants[key] = recording->constants.size();
+    recording->constants.push_back(key);
+  }
+  s << '\001' << n << '\001';
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Aborts on void
+//
+// A dispatch or a case on void calls _dispatch_abort or _case_abort2 with
+// the file name in $a0 and the line in $t1.  That happens at most once a
+// run, so the code at the dispatch or case is only a beqz to a stub after
+// all the methods, one per routine, file and line, which does the call.
+// A stub is named after what it reports, so the code of a class, cached
+// or not, always branches to the same label.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+struct AbortStub {
+  char kind;
+  StringEntry *file;
+  int line;
+};
+
+static std::map<std::string, AbortStub> abort_stubs;     // by label
+
+// The class whose tree the lines of the code being coded are from: the
+// coded class, or the class that defines the clone or the inlined body.
+static CgenNodeP line_class = NULL;
+
+// key is 'D' (dispatch) or 'C' (case), the line, '@' and line_class,
+// ':' and the file name.  The cache keeps the line counted from the line
+// of line_class (CgenClassTable::move_abort_lines).
+static std::string abort_stub_key(char kind, Symbol filename, int line)
+{
+  std::ostringstream key;
+  key << kind << line << '@' << line_class->get_name() << ':' << filename->get_string();
+  return key.str();
+}
+
+// The label of the stub of key, which is emitted by code_abort_stubs;
+// false if the file name is not a constant of this program.
+static bool abort_stub_label(const std::string& key, std::string& label)
+{
+  static std::map<std::string, std::string> known;
+  std::map<std::string, std::string>::iterator it = known.find(key);
+  if (it != known.end()) { label = it->second; return true; }
+
+  size_t colon = key.find(':');
+  StringEntry *file = stringtable.lookup_string((char *) key.c_str() + colon + 1);
+  if (file == NULL) return false;
+  AbortStub stub = { key[0], file, atoi(key.c_str() + 1) };
+  std::ostringstream name;
+  name << (stub.kind == 'D' ? "dispatch_void_" : "case_void_") << stub.line << '_';
+  file->code_ref(name);
+  label = known[key] = name.str();
+  abort_stubs[label] = stub;
+  return true;
+}
+
+// With COOL_IMPLICIT_VOID_CHECKS set, a dispatch or case that needs a
+// check has none in its code: the load of the dispatch table or of the
+// tag from $a0 faults when $a0 is void, and the exception handler
+// (code_void_trap) resumes at the stub of that load.  The loads are listed
+// in the kernel data segment, between _void_sites and _void_sites_end, as
+// pairs of words: the address of the load, then of its stub.  Only a
+// program with such a load has the handler; any other keeps the one of
+// the runtime.
+static bool implicit_void_checks = false;
+
+// void checks coded in this run: as branches, as faulting loads, and
+// left out (cgen.void_checks_*)
+static long void_checks_kept = 0;
+static long void_checks_implicit = 0;
+static long void_checks_removed = 0;
+
+static void emit_abort_stub_ref(const std::string& key, ostream& s)
+{
+  std::string label;
+  if (recording)
+    emit_constant_marker(key, s);
+  else if (abort_stub_label(key, label))
+    s << label;
+}
+
+// The check that $a0 is not void at a dispatch or case (kind 'D' or 'C')
+// of node at line, unless the analysis (check_void) found it cannot be.
+// It is a beqz to the stub, or, if the next instruction loads from $a0
+// (faults) and checks are implicit, a label on that load in _void_sites.
+static void emit_void_check(bool check, bool faults, char kind, CgenNode *node, int line, ostream& s)
+{
+  if (!check) { void_checks_removed++; return; }
+  std::string key = abort_stub_key(kind, node->filename, line);
+  if (faults && implicit_void_checks) {
+    void_checks_implicit++;
+    int site = node->new_label();
+    s << "\t.kdata" << endl << WORD;
+    emit_label_ref(site, s);
+    s << endl << WORD;
+    emit_abort_stub_ref(key, s);
+    s << endl << "\t.text" << endl;
+    emit_label_def(site, s);
+    return;
+  }
+  void_checks_kept++;
+  s << BEQZ << ACC << " ";
+  emit_abort_stub_ref(key, s);
+  s << endl;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // coding strings, ints, and booleans
@@ -395,6 +689,7 @@ static void emit_gc_check(char *source, ostream &s)
 //
 void StringEntry::code_ref(ostream& s)
 {
+  if (recording) { emit_constant_marker('S' + std::string(str, len), s); return; }
   s << STRCONST_PREFIX << index;
 }
 
@@ -435,6 +730,7 @@ void StrTable::code_string_table(ostream& s, int stringclasstag)
 //
 void IntEntry::code_ref(ostream &s)
 {
+  if (recording) { emit_constant_marker('I' + std::string(str, len), s); return; }
   s << INTCONST_PREFIX << index;
 }
 
@@ -566,6 +862,8 @@ void CgenClassTable::code_global_text()
   str << endl << GLOBAL;
   emit_method_ref(idtable.add_string("Main"), idtable.add_string("main"), str);
   str << endl;
+  if (implicit_void_checks)
+    str << "\t.kdata" << endl << "_void_sites" << LABEL << "\t.text" << endl;
 }
 
 void CgenClassTable::code_bools(int boolclasstag)
@@ -624,15 +922,22 @@ CgenClassTable::CgenClassTable(Classes classes, ostream& s) :
 		stringclasstag(MY_STRING_TAG),
 		intclasstag(MY_INT_TAG),
 		boolclasstag(MY_BOOL_TAG),
-		frame_env(new SymbolTable<Symbol,int>()),
-		max_tag(0)
+		frame_env(arena_new<SymbolTable<Symbol,int> >()),
+		max_tag(0),
+		cache_path(getenv("COOL_CGEN_CACHE")),
+		recoded(false),
+		classes_print(0),
+		inline_budget(0)
 {
 	enterscope();
 	frame_env->enterscope();
 	if (cgen_debug) cout << "Building CgenClassTable" << endl;
-	install_basic_classes();
-	install_classes(classes);
-	build_inheritance_tree();
+	{
+		PassTimer pass("cgen.class_table");
+		install_basic_classes();
+		install_classes(classes);
+		build_inheritance_tree();
+	}
 
 	code();
 	frame_env->exitscope();
@@ -641,11 +946,6 @@ CgenClassTable::CgenClassTable(Classes classes, ostream& s) :
 
 void CgenClassTable::install_basic_classes()
 {
-
-// The tree package uses these globals to annotate the classes built below.
-  //curr_lineno  = 0;
-  Symbol filename = stringtable.add_string("<basic class>");
-
 //
 // A few special class names are installed in the lookup table but not
 // the class list.  Thus, these classes exist, but are not part of the
@@ -654,110 +954,17 @@ void CgenClassTable::install_basic_classes()
 // SELF_TYPE is the self class; it cannot be redefined or inherited.
 // prim_slot is a class known to the code generator.
 //
-  addid(No_class,
-	new CgenNode(class_(No_class,No_class,nil_Features(),filename),
-			    Basic,this, -1));
-  addid(SELF_TYPE,
-	new CgenNode(class_(SELF_TYPE,No_class,nil_Features(),filename),
-			    Basic,this, -1));
-  addid(prim_slot,
-	new CgenNode(class_(prim_slot,No_class,nil_Features(),filename),
-			    Basic,this, -1));
+  addid(No_class, new CgenNode(basic_classes[0], Basic, this, -1));
+  addid(SELF_TYPE, new CgenNode(basic_classes[1], Basic, this, -1));
+  addid(prim_slot, new CgenNode(basic_classes[2], Basic, this, -1));
 
-// 
-// The Object class has no parent class. Its methods are
-//        cool_abort() : Object    aborts the program
-//        type_name() : Str        returns a string representation of class name
-//        copy() : SELF_TYPE       returns a copy of the object
 //
-// There is no need for method bodies in the basic classes---these
-// are already built in to the runtime system.
-//
-  install_class(
-   new CgenNode(
-    class_(Object, 
-	   No_class,
-	   append_Features(
-           append_Features(
-           single_Features(method(cool_abort, nil_Formals(), Object, no_expr())),
-           single_Features(method(type_name, nil_Formals(), Str, no_expr()))),
-           single_Features(method(copy, nil_Formals(), SELF_TYPE, no_expr()))),
-	   filename),
-    Basic,this, MY_OBJECT_TAG));
-
-// 
-// The IO class inherits from Object. Its methods are
-//        out_string(Str) : SELF_TYPE          writes a string to the output
-//        out_int(Int) : SELF_TYPE               "    an int    "  "     "
-//        in_string() : Str                    reads a string from the input
-//        in_int() : Int                         "   an int     "  "     "
-//
-   install_class(
-    new CgenNode(
-     class_(IO, 
-            Object,
-            append_Features(
-            append_Features(
-            append_Features(
-            single_Features(method(out_string, single_Formals(formal(arg, Str)),
-                        SELF_TYPE, no_expr())),
-            single_Features(method(out_int, single_Formals(formal(arg, Int)),
-                        SELF_TYPE, no_expr()))),
-            single_Features(method(in_string, nil_Formals(), Str, no_expr()))),
-            single_Features(method(in_int, nil_Formals(), Int, no_expr()))),
-	   filename),	    
-    Basic,this, MY_IO_TAG));
-//
-// The Int class has no methods and only a single attribute, the
-// "val" for the integer. 
-//
-   install_class(
-    new CgenNode(
-     class_(Int, 
-	    Object,
-            single_Features(attr(val, prim_slot, no_expr())),
-	    filename),
-     Basic,this, MY_INT_TAG));
-
+// Object, IO, Int, Bool and String get the tags MY_OBJECT_TAG ..
+// MY_STRING_TAG in this order.
 //
-// Bool also has only the "val" slot.
-//
-    install_class(
-     new CgenNode(
-      class_(Bool, Object, single_Features(attr(val, prim_slot, no_expr())),filename),
-      Basic,this, MY_BOOL_TAG));
-
-//
-// The class Str has a number of slots and operations:
-//       val                                  ???
-//       str_field                            the string itself
-//       length() : Int                       length of the string
-//       concat(arg: Str) : Str               string concatenation
-//       substr(arg: Int, arg2: Int): Str     substring
-//       
-   install_class(
-    new CgenNode(
-      class_(Str, 
-	     Object,
-             append_Features(
-             append_Features(
-             append_Features(
-             append_Features(
-             single_Features(attr(val, Int, no_expr())),
-            single_Features(attr(str_field, prim_slot, no_expr()))),
-            single_Features(method(length, nil_Formals(), Int, no_expr()))),
-            single_Features(method(concat, 
-				   single_Formals(formal(arg, Str)),
-				   Str, 
-				   no_expr()))),
-	    single_Features(method(substr, 
-				   append_Formals(single_Formals(formal(arg, Int)), 
-						  single_Formals(formal(arg2, Int))),
-				   Str, 
-				   no_expr()))),
-	     filename),
-        Basic,this, MY_STRING_TAG));
-   max_tag = MY_STRING_TAG;
+  for (int tag = MY_OBJECT_TAG; tag <= MY_STRING_TAG; tag++)
+    install_class(new CgenNode(basic_classes[3 + tag], Basic, this, tag));
+  max_tag = MY_STRING_TAG;
 }
 
 // CgenClassTable::install_class
@@ -777,8 +984,9 @@ void CgenClassTable::install_class(CgenNodeP nd)
   }
   // The class name is legal, so add it to the list of classes
   // and the symbol table.
-  nds = new List<CgenNode>(nd,nds);
+  nds = arena_new<List<CgenNode> >(nd,nds);
   addid(name,nd);
+  node_index[name] = nd;
 }
 
 void CgenClassTable::install_classes(Classes cs)
@@ -812,7 +1020,7 @@ void CgenClassTable::set_relations(CgenNodeP nd)
 
 void CgenNode::add_child(CgenNodeP n)
 {
-  children = new List<CgenNode>(n,children);
+  children = arena_new<List<CgenNode> >(n,children);
 }
 
 void CgenNode::set_parentnd(CgenNodeP p)
@@ -881,9 +1089,11 @@ void CgenNode::code_dispTab(ostream& s) {
 	std::pair<std::vector<Symbol>, std::map<Symbol,Symbol> > first_app = find_first_appearance_of_methods();
 	for(size_t i = 0; i < first_app.first.size(); ++i) {
 		s << WORD;
-		emit_method_ref(first_app.second[first_app.first[i]], first_app.first[i], s);
+		//a clone takes the place of the method it copies, for this class only
+		Symbol cls = find_clone(first_app.first[i]) != NULL ? name : first_app.second[first_app.first[i]];
+		emit_method_ref(cls, first_app.first[i], s);
 		s << endl;
-		method_offset->addid(first_app.first[i], new int(i));
+		method_offset->addid(first_app.first[i], arena_new<int>(i));
 	}
 }
 
@@ -896,7 +1106,7 @@ int CgenNode::code_attrs(ostream& s, CgenNode* current_node) {
 			//only one attr
 			current_node->attr_offset->addid(
 					dynamic_cast<attr_class*>(features->nth(features->first()))->name,
-					new int(DEFAULT_OBJFIELDS));
+					arena_new<int>(DEFAULT_OBJFIELDS));
 			return DEFAULT_OBJFIELDS + 1;
 		}
 		else {
@@ -909,8 +1119,8 @@ int CgenNode::code_attrs(ostream& s, CgenNode* current_node) {
 			int i2 = features->next(i1);
 			attr_class* attr1 = dynamic_cast<attr_class*>(features->nth(i1));
 			attr_class* attr2 = dynamic_cast<attr_class*>(features->nth(i2));
-			current_node->attr_offset->addid(attr1->name, new int(DEFAULT_OBJFIELDS));
-			current_node->attr_offset->addid(attr2->name, new int(DEFAULT_OBJFIELDS + STRING_SLOTS));
+			current_node->attr_offset->addid(attr1->name, arena_new<int>(DEFAULT_OBJFIELDS));
+			current_node->attr_offset->addid(attr2->name, arena_new<int>(DEFAULT_OBJFIELDS + STRING_SLOTS));
 			return DEFAULT_OBJFIELDS + STRING_SLOTS + 1;
 		}
 	}
@@ -927,7 +1137,7 @@ int CgenNode::code_attrs(ostream& s, CgenNode* current_node) {
 			else s << 0;
 			s << endl;
 
-			current_node->attr_offset->addid(a->name, new int(next_offset++));
+			current_node->attr_offset->addid(a->name, arena_new<int>(next_offset++));
 		}
 	}
 	return next_offset;
@@ -954,14 +1164,1107 @@ int CgenNode::size_in_word() {
 	return sz;
 }
 
+///////////////////////////////////////////////////////////////////////
+//
+// Void checks
+//
+// Before a method body or an attribute initializer is coded, nonvoid()
+// follows it in the order it runs and clears check_void on each dispatch
+// and case whose value cannot be void: self, new, constants, arithmetic
+// and comparisons, any Int, Bool or String (they default to 0, false
+// and ""), and locals holding one of those or already dispatched or
+// cased on.  Each nonvoid() returns whether its own value cannot be void.
+//
+///////////////////////////////////////////////////////////////////////
+
+static bool value_nonvoid(Expression e, NonVoid& known) {
+	bool nonvoid = e->nonvoid(known);
+	Symbol type = e->get_type();
+	return nonvoid || type == Int || type == Bool || type == Str;
+}
+
+//What is known after both of two branches.
+static void meet(NonVoid& known, const NonVoid& other) {
+	std::set<Symbol> both;
+	std::set_intersection(known.known.begin(), known.known.end(),
+			other.known.begin(), other.known.end(), std::inserter(both, both.begin()));
+	known.known.swap(both);
+}
+
+//e passed a void check: if it is a local, it is not void from here on.
+static void passed_void_check(Expression e, NonVoid& known) {
+	object_class* o = dynamic_cast<object_class*>(e);
+	if(o != NULL && known.locals.count(o->name))
+		known.known.insert(o->name);
+}
+
+//body with name bound to a new local, not void if nonvoid.
+static bool nonvoid_in_scope(Symbol name, bool nonvoid, Expression body, NonVoid& known) {
+	bool was_local = known.locals.count(name), was_known = known.known.count(name);
+	known.locals.insert(name);
+	if(nonvoid) known.known.insert(name);
+	else known.known.erase(name);
+	bool result = value_nonvoid(body, known);
+	if(!was_local) known.locals.erase(name);
+	if(was_known) known.known.insert(name);
+	else known.known.erase(name);
+	return result;
+}
+
+static void find_void_checks(method_class* method) {
+	NonVoid known;
+	for(int i = method->formals->first(); method->formals->more(i); i = method->formals->next(i))
+		known.locals.insert(dynamic_cast<formal_class*>(method->formals->nth(i))->name);
+	value_nonvoid(method->expr, known);
+}
+
+bool assign_class::nonvoid(NonVoid& known) {
+	bool result = value_nonvoid(expr, known);
+	if(known.locals.count(name)) {
+		if(result) known.known.insert(name);
+		else known.known.erase(name);
+	}
+	return result;
+}
+
+bool static_dispatch_class::nonvoid(NonVoid& known) {
+	for(int i = actual->first(); actual->more(i); i = actual->next(i))
+		value_nonvoid(actual->nth(i), known);
+	check_void = !value_nonvoid(expr, known);
+	passed_void_check(expr, known);
+	return false;
+}
+
+bool dispatch_class::nonvoid(NonVoid& known) {
+	for(int i = actual->first(); actual->more(i); i = actual->next(i))
+		value_nonvoid(actual->nth(i), known);
+	check_void = !value_nonvoid(expr, known);
+	passed_void_check(expr, known);
+	return false;
+}
+
+bool cond_class::nonvoid(NonVoid& known) {
+	value_nonvoid(pred, known);
+	NonVoid other = known;
+	bool result = value_nonvoid(then_exp, known);
+	result = value_nonvoid(else_exp, other) && result;
+	meet(known, other);
+	return result;
+}
+
+//What holds at the head of the loop holds on entry and after each
+//iteration; it is found by going round until it stops shrinking, and the
+//last time round, from that head, leaves the marks on the checks.
+bool loop_class::nonvoid(NonVoid& known) {
+	NonVoid head = known;
+	for(;;) {
+		known = head;
+		value_nonvoid(pred, known);
+		NonVoid exit = known;
+		value_nonvoid(body, known);
+		meet(known, head);
+		if(known.known.size() == head.known.size()) {
+			known = exit;
+			return false;		//a loop is void
+		}
+		head = known;
+	}
+}
+
+bool typcase_class::nonvoid(NonVoid& known) {
+	check_void = !value_nonvoid(expr, known);
+	passed_void_check(expr, known);
+	NonVoid entry = known;
+	bool result = true;
+	for(int i = cases->first(); cases->more(i); i = cases->next(i)) {
+		branch_class* branch = dynamic_cast<branch_class*>(cases->nth(i));
+		NonVoid after = entry;
+		//the value of a case is never void in a branch
+		result = nonvoid_in_scope(branch->name, true, branch->expr, after) && result;
+		if(i == cases->first()) known = after;
+		else meet(known, after);
+	}
+	return result;
+}
+
+bool block_class::nonvoid(NonVoid& known) {
+	bool result = false;
+	for(int i = body->first(); body->more(i); i = body->next(i))
+		result = value_nonvoid(body->nth(i), known);
+	return result;
+}
+
+bool let_class::nonvoid(NonVoid& known) {
+	bool initial = init->get_type() ? value_nonvoid(init, known) :
+			type_decl == Int || type_decl == Bool || type_decl == Str;
+	return nonvoid_in_scope(identifier, initial, body, known);
+}
+
+#define ARITH_NONVOID(cls)                    \
+bool cls::nonvoid(NonVoid& known) {           \
+	value_nonvoid(e1, known);                 \
+	value_nonvoid(e2, known);                 \
+	return true;                              \
+}
+ARITH_NONVOID(plus_class)
+ARITH_NONVOID(sub_class)
+ARITH_NONVOID(mul_class)
+ARITH_NONVOID(divide_class)
+ARITH_NONVOID(lt_class)
+ARITH_NONVOID(eq_class)
+ARITH_NONVOID(leq_class)
+#undef ARITH_NONVOID
+
+bool neg_class::nonvoid(NonVoid& known) { value_nonvoid(e1, known); return true; }
+bool comp_class::nonvoid(NonVoid& known) { value_nonvoid(e1, known); return true; }
+bool isvoid_class::nonvoid(NonVoid& known) { value_nonvoid(e1, known); return true; }
+bool int_const_class::nonvoid(NonVoid& known) { return true; }
+bool string_const_class::nonvoid(NonVoid& known) { return true; }
+bool bool_const_class::nonvoid(NonVoid& known) { return true; }
+bool new__class::nonvoid(NonVoid& known) { return true; }
+bool no_expr_class::nonvoid(NonVoid& known) { return false; }
+
+bool object_class::nonvoid(NonVoid& known) {
+	return name == self || known.known.count(name);
+}
+
+///////////////////////////////////////////////////////////////////////
+//
+// Tail calls
+//
+// A dispatch in tail position does not come back to its method: its
+// arguments are copied over the method's own, from the first, and the
+// frame is given up before the jump, so the callee returns straight to
+// the method's caller.  A call of the method itself is a loop: the
+// frame stays and the jump is to just after the prologue.  Other tail
+// calls need their arguments to fit where the method's arguments and
+// saved registers were.  Register arguments are in their registers by
+// then and take no room.
+//
+///////////////////////////////////////////////////////////////////////
+
+static method_class* coded_method;
+static int coded_args;		//words of arguments the coded method takes on the stack
+static int tail_entry;		//label of the coded method after its prologue; -1 if unused
+static long tail_calls = 0;
+static long tail_loops = 0;
+
+//Of the class a fact is about, or 0 for none.
+static uint64_t class_print(CgenNodeP cls) {
+	return cls == NULL ? 0 : fingerprint(cls->get_name()->get_string(), cls->get_name()->get_len());
+}
+
+//Marks the dispatches e ends with.
+static void mark_tail_calls(Expression e) {
+	if(dispatch_class* d = dynamic_cast<dispatch_class*>(e))
+		d->tail = true;
+	else if(static_dispatch_class* d = dynamic_cast<static_dispatch_class*>(e))
+		d->tail = true;
+	else if(cond_class* c = dynamic_cast<cond_class*>(e)) {
+		mark_tail_calls(c->then_exp);
+		mark_tail_calls(c->else_exp);
+	} else if(block_class* b = dynamic_cast<block_class*>(e))
+		mark_tail_calls(b->body->nth(b->body->len() - 1));
+	else if(let_class* l = dynamic_cast<let_class*>(e))
+		mark_tail_calls(l->body);
+	else if(typcase_class* c = dynamic_cast<typcase_class*>(e)) {
+		for(int i = c->cases->first(); c->cases->more(i); i = c->cases->next(i))
+			mark_tail_calls(dynamic_cast<branch_class*>(c->cases->nth(i))->expr);
+	}
+}
+
+//true if a dispatch to name on type runs the method coded.
+static bool calls_coded_method(CgenNode* current_node, Symbol type, Symbol name, bool exact) {
+	CgenNodeP cls = current_node->get_class_table()->bound_class(type, name, exact);
+	note_fact(exact ? FACT_BOUND_STATIC : FACT_BOUND, type, name, class_print(cls));
+	return cls != NULL && cls->find_method(name) == coded_method;
+}
+
+//Copies the last nargs words pushed over the arguments of the method coded.
+static void emit_tail_arguments(int nargs, ostream& s) {
+	int first_arg = frame_size + frame_temps - nargs + 1;	//below $fp
+	int top = coded_args + 2;		//the first argument, above $fp
+	for(int i = 0; i < nargs; i++) {
+		emit_load(T2, -(first_arg + i), FP, s);
+		emit_store(T2, top - i, FP, s);
+	}
+}
+
+//The coded method again, on $a0, with the last nargs words pushed.
+static void emit_tail_loop(CgenNode* current_node, int nargs, ostream& s) {
+	emit_tail_arguments(nargs, s);
+	emit_addiu(SP, FP, -4 * (frame_size + 1), s);
+	if(tail_entry < 0)
+		tail_entry = current_node->new_label();
+	emit_branch(tail_entry, s);
+	unreachable = true;
+	tail_loops++;
+}
+
+//true if a tail call with nargs arguments can take the frame's place.
+static bool tail_call_fits(int nargs) {
+	return nargs <= coded_args + 3;
+}
+
+//The method at $t1 on $a0, with the last nargs words pushed, in place
+//of the coded method.
+static void emit_tail_call(int nargs, ostream& s) {
+	emit_load(RA, 0, FP, s);
+	emit_load(SELF, 1, FP, s);
+	emit_load(T3, 2, FP, s);
+	emit_tail_arguments(nargs, s);
+	emit_addiu(SP, FP, 4 * (coded_args + 2 - nargs), s);
+	emit_move(FP, T3, s);
+	emit_jr(T1, s);
+	unreachable = true;
+	tail_calls++;
+}
+
+///////////////////////////////////////////////////////////////////////
+//
+// Inlining
+//
+// A dispatch whose method is known at compile time and small runs the
+// body of the method in place of the call: a static dispatch, or a
+// dispatch on a type no class below which defines the method again.
+// The arguments stay where they were pushed and are the formals; the
+// caller's $s0 is pushed above them while the body runs with the
+// receiver in $s0.  Calls in an inlined body are not inlined.
+//
+///////////////////////////////////////////////////////////////////////
+
+//words of the binary AST of the largest body inlined, unless
+//COOL_INLINE_BUDGET says otherwise; 0 inlines nothing
+#define DEFAULT_INLINE_BUDGET 16
+
+static bool inlining = false;
+static bool inlining_tail = false;		//of a call in tail position, whose tail calls are too
+static long inlined_calls = 0;
+
+method_class* CgenNode::find_method(Symbol name) {
+	for(int i = features->first(); features->more(i); i = features->next(i)) {
+		method_class* m = dynamic_cast<method_class*>(features->nth(i));
+		if(m != NULL && m->name == name)
+			return m;
+	}
+	return NULL;
+}
+
+bool CgenNode::overridden_below(Symbol name) {
+	for(List<CgenNode>* l = children; l; l = l->tl()) {
+		if(l->hd()->find_method(name) != NULL || l->hd()->overridden_below(name))
+			return true;
+	}
+	return false;
+}
+
+CgenNodeP CgenClassTable::bound_class(Symbol type, Symbol name, bool exact) {
+	CgenNodeP node = node_index[type];
+	if(!exact && node->overridden_below(name))
+		return NULL;
+	for(; node != NULL; node = node->get_parentnd()) {
+		if(node->find_method(name) != NULL)
+			return node;
+	}
+	return NULL;
+}
+
+const InlineTarget& CgenClassTable::inline_target(Symbol type, Symbol name, bool exact) {
+	std::pair<Symbol, Symbol> key(type, name);
+	std::map<std::pair<Symbol, Symbol>, InlineTarget>::iterator it = inline_targets[exact].find(key);
+	if(it != inline_targets[exact].end())
+		return it->second;
+	InlineTarget& target = inline_targets[exact][key];
+	target.cls = NULL;
+	target.method = NULL;
+	target.print = 0;
+	CgenNodeP node = inline_budget > 0 ? bound_class(type, name, exact) : NULL;
+	if(node == NULL || node->basic())
+		return target;
+	method_class* method = node->find_method(name);
+	AstWriter w;
+	w.lines_from(node->get_source()->get_line_number());
+	method->expr->write_binary(w);
+	if(w.size() > (size_t) inline_budget)
+		return target;
+	std::vector<uint32_t> image;
+	w.image(image);
+	target.cls = node;
+	target.method = method;
+	target.print = fingerprint(image.data(), image.size() * sizeof(uint32_t), class_print(node));
+	return target;
+}
+
+static bool is_self(Expression e) {
+	object_class* o = dynamic_cast<object_class*>(e);
+	return o != NULL && o->name == self;
+}
+
+//The call of target on $a0, whose arguments are the last nargs words
+//pushed; $s0 is left alone when $a0 is self already.
+static void emit_inlined_call(const InlineTarget& target, int nargs, bool on_self, bool tail, ostream& s) {
+	int first_arg = frame_size + frame_temps - nargs + 1;	//slot of the first argument below $fp
+	//a body that does not use self runs with $s0 as it is
+	FrameUse use(target.cls);
+	use.inlined = true;
+	Formals formals = target.method->formals;
+	for(int i = formals->first(); formals->more(i); i = formals->next(i))
+		use.locals.insert(dynamic_cast<formal_class*>(formals->nth(i))->name);
+	target.method->expr->frame_use(use);
+	on_self |= !use.self;
+	if(!on_self) {
+		emit_push(SELF, s);
+		emit_move(SELF, ACC, s);
+	}
+	SymbolTable<Symbol, int>* env = arena_new<SymbolTable<Symbol, int> >();
+	env->enterscope();
+	int slot = first_arg;
+	for(int i = formals->first(); formals->more(i); i = formals->next(i))
+		env->addid(dynamic_cast<formal_class*>(formals->nth(i))->name, arena_new<int>(-slot++));
+	find_void_checks(target.method);
+	mark_tail_calls(target.method->expr);
+	inlining = true;
+	inlining_tail = tail;
+	CgenNodeP caller = line_class;
+	line_class = target.cls;
+	target.method->expr->code(s, target.cls, env);
+	line_class = caller;
+	inlining = false;
+	if(!on_self) {
+		emit_load(SELF, 1, SP, s);
+		nargs++;
+	}
+	if(nargs > 0)
+		emit_pop(nargs, s);
+	inlined_calls++;
+}
+
+///////////////////////////////////////////////////////////////////////
+//
+// Register arguments
+//
+// With COOL_REGISTER_ARGS=n (at most 3), a method takes its first n
+// arguments in $a1.. and the others on the stack.  The methods of the
+// runtime take all theirs on the stack, and so do the methods that
+// override them: those whose name first appears in a basic class.  A
+// method that calls keeps its register arguments in the first slots of
+// its frame; a leaf leaves them where they came.  A caller moves each
+// register argument straight from $a0 when nothing coded after it
+// calls, and keeps it in a slot until the call otherwise.  The result
+// is in $a0 in either convention.
+//
+///////////////////////////////////////////////////////////////////////
+
+#define MAX_REGISTER_ARGS 3
+
+static int register_args = 0;
+static char* arg_regs[MAX_REGISTER_ARGS] = { A1, A2, A3 };
+static std::map<int, char*> slot_regs;		//formals of the coded leaf method, by slot
+static long register_arguments_passed = 0;
+static long register_arguments_spilled = 0;
+
+//The class above cls, or cls, where name first appears.
+static CgenNodeP root_class(CgenNodeP cls, Symbol name) {
+	CgenNodeP root = NULL;
+	for(; cls != NULL; cls = cls->get_parentnd()) {
+		if(cls->find_method(name) != NULL)
+			root = cls;
+	}
+	return root;
+}
+
+//How many of the nargs arguments of name on type go in registers.
+static int args_in_registers(CgenClassTable* table, Symbol type, Symbol name, int nargs) {
+	if(register_args == 0 || nargs == 0)
+		return 0;
+	CgenNodeP root = root_class(table->lookup(type), name);
+	return root == NULL || root->basic() ? 0 : std::min(nargs, register_args);
+}
+
+//args_in_registers() for the code of current_node, noting the fact.
+static int register_arguments(CgenNode* current_node, Symbol type, Symbol name, int nargs) {
+	if(register_args == 0 || nargs == 0)
+		return 0;
+	CgenClassTable* table = current_node->get_class_table();
+	note_fact(FACT_ROOT, type, name, class_print(root_class(table->lookup(type), name)));
+	return args_in_registers(table, type, name, nargs);
+}
+
+//true if the code of e calls.
+static bool expr_calls(Expression e, CgenNodeP cls) {
+	FrameUse use(cls);
+	use.inlined = inlining;
+	use.tail = inlining_tail;
+	e->frame_use(use);
+	return use.calls;
+}
+
+//The first argument of a call after which neither the other arguments
+//nor the receiver call.
+static int first_direct_arg(Expressions actual, Expression expr, CgenNodeP cls) {
+	int i = actual->len();
+	bool after = expr_calls(expr, cls);
+	while(i > 0 && !after)
+		after = expr_calls(actual->nth(--i), cls);
+	return i;
+}
+
+///////////////////////////////////////////////////////////////////////
+//
+// Customization
+//
+// With COOL_CUSTOMIZE=n, a class gets its own copy of the inherited
+// methods that dispatch on self or make a new SELF_TYPE, nearest
+// definitions first, up to n words of binary AST in all.  A copy is
+// coded as a method of the class and only its dispatch table holds it,
+// so its self is of exactly that class: a dispatch on self calls the
+// method that table holds directly, or inlines it, and new SELF_TYPE
+// makes the class.  The methods as defined stay for the other classes
+// and for static dispatch, which then calls them directly rather than
+// through the table of its type, where a copy could be.
+//
+///////////////////////////////////////////////////////////////////////
+
+static int customize = 0;
+static bool cloning = false;		//coding a clone, whose self is of the class coded
+static long clones_made = 0;
+static long clone_words = 0;
+static long direct_self_calls = 0;
+
+//Appends e and every expression in it to out.
+static void subexpressions(Expression e, std::vector<Expression>& out) {
+	#define VISIT(e) subexpressions(e, out)
+	#define VISIT_BINARY(type) \
+	else if(type* b = dynamic_cast<type*>(e)) { VISIT(b->e1); VISIT(b->e2); }
+	out.push_back(e);
+	if(assign_class* a = dynamic_cast<assign_class*>(e))
+		VISIT(a->expr);
+	else if(static_dispatch_class* d = dynamic_cast<static_dispatch_class*>(e)) {
+		VISIT(d->expr);
+		for(int i = d->actual->first(); d->actual->more(i); i = d->actual->next(i))
+			VISIT(d->actual->nth(i));
+	} else if(dispatch_class* d = dynamic_cast<dispatch_class*>(e)) {
+		VISIT(d->expr);
+		for(int i = d->actual->first(); d->actual->more(i); i = d->actual->next(i))
+			VISIT(d->actual->nth(i));
+	} else if(cond_class* c = dynamic_cast<cond_class*>(e)) {
+		VISIT(c->pred);
+		VISIT(c->then_exp);
+		VISIT(c->else_exp);
+	} else if(loop_class* l = dynamic_cast<loop_class*>(e)) {
+		VISIT(l->pred);
+		VISIT(l->body);
+	} else if(typcase_class* c = dynamic_cast<typcase_class*>(e)) {
+		VISIT(c->expr);
+		for(int i = c->cases->first(); c->cases->more(i); i = c->cases->next(i))
+			VISIT(dynamic_cast<branch_class*>(c->cases->nth(i))->expr);
+	} else if(block_class* b = dynamic_cast<block_class*>(e)) {
+		for(int i = b->body->first(); b->body->more(i); i = b->body->next(i))
+			VISIT(b->body->nth(i));
+	} else if(let_class* l = dynamic_cast<let_class*>(e)) {
+		VISIT(l->init);
+		VISIT(l->body);
+	}
+	VISIT_BINARY(plus_class)
+	VISIT_BINARY(sub_class)
+	VISIT_BINARY(mul_class)
+	VISIT_BINARY(divide_class)
+	VISIT_BINARY(lt_class)
+	VISIT_BINARY(eq_class)
+	VISIT_BINARY(leq_class)
+	else if(neg_class* n = dynamic_cast<neg_class*>(e))
+		VISIT(n->e1);
+	else if(comp_class* c = dynamic_cast<comp_class*>(e))
+		VISIT(c->e1);
+	else if(isvoid_class* v = dynamic_cast<isvoid_class*>(e))
+		VISIT(v->e1);
+	#undef VISIT_BINARY
+	#undef VISIT
+}
+
+method_class* CgenNode::find_clone(Symbol name) {
+	for(size_t i = 0; i < clones.size(); i++) {
+		if(clones[i]->name == name)
+			return clones[i];
+	}
+	return NULL;
+}
+
+void CgenNode::add_clone(method_class* method, uint64_t print) {
+	clones.push_back(method);
+	clones_print = fingerprint(&print, sizeof(print), clones_print);
+}
+
+//true if a copy of method for a class would be coded better: it
+//dispatches on self or makes a new SELF_TYPE.
+static bool uses_own_class(method_class* method) {
+	std::vector<Expression> all;
+	subexpressions(method->expr, all);
+	for(size_t i = 0; i < all.size(); i++) {
+		dispatch_class* d = dynamic_cast<dispatch_class*>(all[i]);
+		new__class* n = dynamic_cast<new__class*>(all[i]);
+		if((d != NULL && is_self(d->expr)) || (n != NULL && n->type_name == SELF_TYPE))
+			return true;
+	}
+	return false;
+}
+
+void CgenClassTable::choose_clones() {
+	std::map<method_class*, std::pair<size_t, uint64_t> > sizes;	//words and print of each clone wanted
+	for(List<CgenNode>* l = nds; l; l = l->tl()) {
+		CgenNodeP node = l->hd();
+		if(node->basic())
+			continue;
+		int left = customize;
+		std::set<Symbol> defined;		//by a class passed on the way up
+		for(CgenNodeP up = node; up != NULL && !up->basic(); up = up->get_parentnd()) {
+			for(int i = up->features->first(); up->features->more(i); i = up->features->next(i)) {
+				method_class* method = dynamic_cast<method_class*>(up->features->nth(i));
+				if(method == NULL || !defined.insert(method->name).second || up == node)
+					continue;
+				std::map<method_class*, std::pair<size_t, uint64_t> >::iterator it = sizes.find(method);
+				if(it == sizes.end()) {
+					std::pair<size_t, uint64_t> size(0, 0);
+					if(uses_own_class(method)) {
+						AstWriter w;
+						w.lines_from(up->get_source()->get_line_number());
+						method->expr->write_binary(w);
+						std::vector<uint32_t> image;
+						w.image(image);
+						size.first = w.size();
+						size.second = fingerprint(image.data(), image.size() * sizeof(uint32_t), class_print(up));
+					}
+					it = sizes.insert(std::make_pair(method, size)).first;
+				}
+				if(it->second.first == 0 || it->second.first > (size_t) left)
+					continue;
+				node->add_clone(method, it->second.second);
+				left -= it->second.first;
+				clones_made++;
+				clone_words += it->second.first;
+			}
+		}
+	}
+}
+
+//The class whose code for name a receiver of exactly cls runs.
+static CgenNodeP slot_class(CgenNodeP cls, Symbol name) {
+	if(cls->find_method(name) != NULL || cls->find_clone(name) != NULL)
+		return cls;
+	return cls->get_class_table()->bound_class(cls->get_name(), name, true);
+}
+
+//true if expr is self in the code of a clone, not inlined in it.
+static bool exact_receiver(Expression expr, bool inlined) {
+	return cloning && !inlined && is_self(expr);
+}
+
+///////////////////////////////////////////////////////////////////////
+//
+// Frames
+//
+// The prologue allocates the whole frame with one adjustment of $sp: the
+// registers the code needs saved, and frame_size slots for the values it
+// keeps (operands of arithmetic, let and case variables), counted by
+// frame_use() before the code is made.  It saves $ra if the code calls
+// and comes back, $s0 if it uses self, and $fp only for a tail call,
+// which saves all three.  The slots are numbered in words from where $fp
+// points, or would: the lowest saved register.  The formals are above
+// it, after the saved registers, and the values below.  Without $fp a
+// slot is addressed off $sp, frame_size + frame_temps words further down.
+//
+// Arguments on the stack are popped by the callee; a call allocates the
+// words of all of them at once and stores each.
+//
+///////////////////////////////////////////////////////////////////////
+
+static bool frame_fp;
+static bool frame_self;
+static bool frame_ra;
+static int frame_saved;			//words the prologue pushed
+static long frames = 0;
+static long frames_without_fp = 0;
+static long frames_without_self = 0;
+static long frames_without_ra = 0;
+
+//body, with a slot in use.
+static void frame_use_with_slot(Expression body, FrameUse& use) {
+	if(++use.depth > use.size)
+		use.size = use.depth;
+	body->frame_use(use);
+	use.depth--;
+}
+
+//body with name bound to a new local, in a slot.
+static void frame_use_in_scope(Symbol name, Expression body, FrameUse& use) {
+	bool was_local = use.locals.count(name);
+	use.locals.insert(name);
+	frame_use_with_slot(body, use);
+	if(!was_local) use.locals.erase(name);
+}
+
+//Of a local or an attribute.
+static void frame_use_name(Symbol name, FrameUse& use) {
+	if(name == self || !use.locals.count(name))
+		use.self = true;
+}
+
+void assign_class::frame_use(FrameUse& use) {
+	expr->frame_use(use);
+	frame_use_name(name, use);
+}
+
+//Of the call of target on expr, which is inlined if target has a body
+//and the call is not in an inlined body itself; the tail calls of a body
+//inlined in tail position are tail calls too.
+static void frame_use_call(Expression expr, const InlineTarget& target, bool tail, FrameUse& use) {
+	if(target.cls == NULL || use.inlined) {
+		use.calls = true;
+		return;
+	}
+	FrameUse body(target.cls);
+	body.inlined = true;
+	body.tail = tail;
+	body.depth = body.size = use.depth;
+	Formals formals = target.method->formals;
+	for(int i = formals->first(); formals->more(i); i = formals->next(i))
+		body.locals.insert(dynamic_cast<formal_class*>(formals->nth(i))->name);
+	if(tail)
+		mark_tail_calls(target.method->expr);
+	target.method->expr->frame_use(body);
+	use.calls |= body.calls;
+	use.size = std::max(use.size, body.size);
+	//the body's self is the receiver, which it puts in $s0 and takes out
+	if(is_self(expr))
+		use.self |= body.self;
+	//but its tail calls take $s0 back from the frame
+	if(body.fp)
+		use.self = use.fp = true;
+}
+
+//true if a dispatch of name on type in tail position loops back to the
+//method coded, as code() decides.
+static bool frame_use_loop(Symbol type, Symbol name, bool exact, FrameUse& use) {
+	return (exact || !cloning) && calls_coded_method(use.cls, type, name, exact);
+}
+
+//Of the arguments and the receiver of a call of name on type, with a
+//slot for each register argument emit_arguments() may keep, unless the
+//call is inlined.
+static void frame_use_operands(Expressions actual, Expression expr, Symbol type, Symbol name,
+		bool inlined, FrameUse& use) {
+	int held = 0;
+	if(!inlined)
+		held = args_in_registers(use.cls->get_class_table(), type, name, actual->len());
+	use.depth += held;
+	if(use.depth > use.size)
+		use.size = use.depth;
+	for(int i = actual->first(); actual->more(i); i = actual->next(i))
+		actual->nth(i)->frame_use(use);
+	expr->frame_use(use);
+	use.depth -= held;
+}
+
+void static_dispatch_class::frame_use(FrameUse& use) {
+	const InlineTarget& target = use.cls->get_class_table()->inline_target(type_name, name, true);
+	bool tail_call = tail && (!use.inlined || use.tail);
+	bool loop = tail_call && frame_use_loop(type_name, name, true, use);
+	bool inlined = target.cls != NULL && !use.inlined && !loop;
+	frame_use_operands(actual, expr, type_name, name, inlined, use);
+	if(inlined)
+		frame_use_call(expr, target, tail_call, use);
+	else if(tail_call)
+		use.calls = use.self = use.fp = true;
+	else
+		use.calls = true;
+}
+
+void dispatch_class::frame_use(FrameUse& use) {
+	Symbol type = expr->get_type() == SELF_TYPE ? use.cls->get_name() : expr->get_type();
+	bool exact = exact_receiver(expr, use.inlined);
+	const InlineTarget& target = use.cls->get_class_table()->inline_target(type, name, exact);
+	bool tail_call = tail && (!use.inlined || use.tail);
+	bool loop = tail_call && frame_use_loop(type, name, exact, use);
+	bool inlined = target.cls != NULL && !use.inlined && !loop;
+	frame_use_operands(actual, expr, type, name, inlined, use);
+	if(inlined) {
+		frame_use_call(expr, target, tail_call, use);
+		return;
+	}
+	if(tail_call) {
+		use.calls = use.self = use.fp = true;
+		return;
+	}
+	use.calls = true;
+	//a speculative call may run the body of the method guessed
+	CgenClassTable* table = use.cls->get_class_table();
+	if(target.cls == NULL && !use.inlined && !exact && args_in_registers(table, type, name, actual->len()) == 0) {
+		const Speculation& guess = table->speculation(type, name);
+		if(guess.cls != NULL)
+			frame_use_call(expr, table->inline_target(guess.cls->get_name(), name, true), false, use);
+	}
+}
+
+void cond_class::frame_use(FrameUse& use) {
+	pred->frame_use(use);
+	then_exp->frame_use(use);
+	else_exp->frame_use(use);
+}
+
+void loop_class::frame_use(FrameUse& use) {
+	pred->frame_use(use);
+	body->frame_use(use);
+}
+
+void typcase_class::frame_use(FrameUse& use) {
+	expr->frame_use(use);
+	for(int i = cases->first(); cases->more(i); i = cases->next(i)) {
+		branch_class* branch = dynamic_cast<branch_class*>(cases->nth(i));
+		frame_use_in_scope(branch->name, branch->expr, use);
+	}
+}
+
+void block_class::frame_use(FrameUse& use) {
+	for(int i = body->first(); body->more(i); i = body->next(i))
+		body->nth(i)->frame_use(use);
+}
+
+void let_class::frame_use(FrameUse& use) {
+	init->frame_use(use);
+	frame_use_in_scope(identifier, body, use);
+}
+
+//e1 is kept in a slot while e2 is coded; all but < and <= then call
+//Object.copy, or equality_test for =
+#define BINARY_FRAME_USE(cls, call)           \
+void cls::frame_use(FrameUse& use) {          \
+	e1->frame_use(use);                       \
+	frame_use_with_slot(e2, use);             \
+	use.calls |= call;                        \
+}
+BINARY_FRAME_USE(plus_class, true)
+BINARY_FRAME_USE(sub_class, true)
+BINARY_FRAME_USE(mul_class, true)
+BINARY_FRAME_USE(divide_class, true)
+BINARY_FRAME_USE(eq_class, true)
+BINARY_FRAME_USE(lt_class, false)
+BINARY_FRAME_USE(leq_class, false)
+#undef BINARY_FRAME_USE
+
+void neg_class::frame_use(FrameUse& use) { e1->frame_use(use); use.calls = true; }
+void comp_class::frame_use(FrameUse& use) { e1->frame_use(use); }
+void isvoid_class::frame_use(FrameUse& use) { e1->frame_use(use); }
+void int_const_class::frame_use(FrameUse& use) { }
+void string_const_class::frame_use(FrameUse& use) { }
+void bool_const_class::frame_use(FrameUse& use) { }
+void no_expr_class::frame_use(FrameUse& use) { }
+
+void new__class::frame_use(FrameUse& use) {
+	use.calls = true;
+	if(type_name == SELF_TYPE && !(cloning && !use.inlined))
+		use.self = true;
+}
+
+void object_class::frame_use(FrameUse& use) {
+	frame_use_name(name, use);
+}
+
+static void emit_prologue(const FrameUse& use, ostream& s) {
+	frame_fp = use.fp;
+	frame_self = use.self;
+	frame_ra = use.calls;
+	frame_saved = frame_fp + frame_self + frame_ra;
+	frame_size = use.size;
+	frame_depth = 0;
+	frame_temps = 0;
+	slot_regs.clear();
+	int slot = frame_saved + frame_size;		//above $sp, of the first register saved
+	if(slot > 0)
+		emit_addiu(SP,SP,-4 * slot,s);
+	if(frame_fp)
+		emit_store(FP,slot--,SP,s); 		//store the frame pointer $fp
+	if(frame_self)
+		emit_store(SELF,slot--,SP,s);		//store the self pointer $self
+	if(frame_ra)
+		emit_store(RA,slot--,SP,s);		//store the return address $ra
+	//a collector scanning the stack must not take what was there for pointers
+	if(cgen_Memmgr != GC_NOGC) {
+		for(; slot > 0; slot--)
+			emit_store(ZERO,slot,SP,s);
+	}
+
+	if(frame_fp)
+		emit_addiu(FP,SP,4 * (frame_size + 1),s);	//set the new frame pointer $fp
+
+	frames++;
+	frames_without_fp += !frame_fp;
+	frames_without_self += !frame_self;
+	frames_without_ra += !frame_ra;
+}
+
+//The frame of the routine whose prologue was just emitted, in the
+//statistics cgen.frame.<routine>.saved, the registers it saves, and
+//cgen.frame.<routine>.slots; both are 0 when it has no frame.
+static void frame_statistics(Symbol cls, Symbol method) {
+	if(!passes_enabled() && !recording)
+		return;
+	std::ostringstream routine;
+	routine << "cgen.frame.";
+	if(method != NULL)
+		emit_method_ref(cls, method, routine);
+	else
+		emit_init_ref(cls, routine);
+	class_statistic(routine.str() + ".saved", frame_saved);
+	class_statistic(routine.str() + ".slots", frame_size);
+}
+
+//Returns from a frame with nargs words of arguments.
+static void emit_epilogue(int nargs, ostream& s) {
+	int slot = frame_saved + frame_size;
+	if(frame_fp)
+		emit_load(FP,slot--,SP,s);	//Retrieve old $fp, $self and $ra.
+	if(frame_self)
+		emit_load(SELF,slot--,SP,s);
+	if(frame_ra)
+		emit_load(RA,slot--,SP,s);
+	if(frame_saved + frame_size + nargs > 0)
+		emit_addiu(SP,SP,4 * (frame_saved + frame_size + nargs),s);	//Restore $sp
+	emit_return(s);			//return
+}
+
+//A slot for a value the code keeps, at the returned offset; free_slot()
+//gives back the last one.
+static int new_slot() {
+	assert(frame_depth < frame_size);
+	return -(++frame_depth);
+}
+
+static void free_slot() {
+	frame_depth--;
+}
+
+//The frame slot offset words above where $fp points, or would.
+static void emit_load_slot(char *dest_reg, int offset, ostream& s) {
+	std::map<int, char*>::iterator reg = slot_regs.find(offset);
+	if(reg != slot_regs.end())
+		emit_move(dest_reg, reg->second, s);
+	else if(frame_fp)
+		emit_load(dest_reg, offset, FP, s);
+	else
+		emit_load(dest_reg, offset + frame_size + frame_temps + 1, SP, s);
+}
+
+static void emit_store_slot(char *source_reg, int offset, ostream& s) {
+	std::map<int, char*>::iterator reg = slot_regs.find(offset);
+	if(reg != slot_regs.end())
+		emit_move(reg->second, source_reg, s);
+	else if(frame_fp)
+		emit_store(source_reg, offset, FP, s);
+	else
+		emit_store(source_reg, offset + frame_size + frame_temps + 1, SP, s);
+}
+
+//Codes the arguments of a call, the first nreg of which go in registers
+//and the others in the words above $sp, where the callee takes them from
+//and which it pops.  Unless a collector could scan those before they are
+//set, they are allocated at once.  Returns how many register arguments
+//are kept in slots, for emit_held_arguments().
+static int emit_arguments(Expressions actual, Expression expr, int nreg, CgenNode* current_node,
+		SymbolTable<Symbol, int>* frame_env, ostream& s) {
+	int nargs = actual->len();
+	int held = nreg > 0 ? std::min(nreg, first_direct_arg(actual, expr, current_node)) : 0;
+	bool allocate = cgen_Memmgr == GC_NOGC && nargs - nreg > 1;
+	if(allocate) {
+		emit_addiu(SP,SP,-4 * (nargs - nreg),s);
+		frame_temps += nargs - nreg;
+	}
+	for(int i = actual->first(); actual->more(i); i = actual->next(i)) {
+		actual->nth(i)->code(s, current_node, frame_env);
+		if(i < held)
+			emit_store_slot(ACC, new_slot(), s);
+		else if(i < nreg)
+			emit_move(arg_regs[i], ACC, s);
+		else if(allocate)
+			emit_store(ACC, nargs - i, SP, s);
+		else
+			emit_push(ACC, s);
+	}
+	register_arguments_passed += nreg;
+	return held;
+}
+
+//Puts the first held register arguments of a call in their registers,
+//from the last slots taken.
+static void emit_held_arguments(int held, ostream& s) {
+	for(int i = 0; i < held; i++)
+		emit_load_slot(arg_regs[i], -(frame_depth - held + 1 + i), s);
+	for(int i = 0; i < held; i++)
+		free_slot();
+}
+
+///////////////////////////////////////////////////////////////////////
+//
+// Speculative dispatch
+//
+// With COOL_SPECULATE set, a dispatch whose method depends on the
+// receiver first compares the receiver's tag with that of the class it
+// most likely has.  On a match it calls that class's method directly, or
+// runs the body in place if it is small enough to inline; any other
+// receiver goes through the dispatch table.  The guess is the class, of
+// the static type or below, that the most new expressions in the program
+// make, counting Main once for the runtime.  COOL_DISPATCH_PROFILE may
+// name a file with lines
+//
+//    Type.method Class
+//
+// giving the receiver seen most at dispatches to method on Type; sites it
+// lists take its guess, and it turns speculation on.  Calls in tail
+// position are not speculated.  The calls through the table are put
+// after the epilogue, so that a receiver guessed right takes no branch
+// but the call.
+//
+///////////////////////////////////////////////////////////////////////
+
+static bool speculate = false;
+static std::map<std::pair<Symbol, Symbol>, Symbol> dispatch_profile;
+static long speculative_calls = 0;
+static long speculative_inlined = 0;
+static std::ostringstream out_of_line;		//code after the epilogue, which branches back
+
+//Reads a COOL_DISPATCH_PROFILE file; false if there is none.
+static bool read_dispatch_profile(const char* path) {
+	std::ifstream in(path);
+	if(!in)
+		return false;
+	std::string line;
+	while(std::getline(in, line)) {
+		std::istringstream fields(line);
+		std::string site, cls;
+		size_t dot;
+		if(!(fields >> site >> cls) || site[0] == '#' || (dot = site.find('.')) == std::string::npos)
+			continue;
+		Symbol type = idtable.add_string((char*) site.substr(0, dot).c_str());
+		Symbol name = idtable.add_string((char*) site.substr(dot + 1).c_str());
+		dispatch_profile[std::make_pair(type, name)] = idtable.add_string((char*) cls.c_str());
+	}
+	return true;
+}
+
+//Counts the new expressions in e by the class they make, cls for SELF_TYPE.
+static void count_new_sites(Expression e, Symbol cls, std::map<Symbol, int>& sites) {
+	std::vector<Expression> all;
+	subexpressions(e, all);
+	for(size_t i = 0; i < all.size(); i++) {
+		if(new__class* n = dynamic_cast<new__class*>(all[i]))
+			sites[n->type_name == SELF_TYPE ? cls : n->type_name]++;
+	}
+}
+
+void CgenClassTable::count_new_sites() {
+	for(List<CgenNode>* l = nds; l; l = l->tl()) {
+		Features features = l->hd()->features;
+		for(int i = features->first(); features->more(i); i = features->next(i)) {
+			if(method_class* m = dynamic_cast<method_class*>(features->nth(i)))
+				::count_new_sites(m->expr, l->hd()->get_name(), new_sites);
+			else
+				::count_new_sites(dynamic_cast<attr_class*>(features->nth(i))->init, l->hd()->get_name(), new_sites);
+		}
+	}
+	new_sites[Main]++;
+}
+
+//The class at or below node that the most new expressions make, if any.
+static void most_made(CgenNodeP node, const std::map<Symbol, int>& sites, int& most, CgenNodeP& cls) {
+	std::map<Symbol, int>::const_iterator it = sites.find(node->get_name());
+	if(it != sites.end() && it->second > most) {
+		most = it->second;
+		cls = node;
+	}
+	for(List<CgenNode>* l = node->get_children(); l; l = l->tl())
+		most_made(l->hd(), sites, most, cls);
+}
+
+const Speculation& CgenClassTable::speculation(Symbol type, Symbol name) {
+	std::pair<Symbol, Symbol> key(type, name);
+	std::map<std::pair<Symbol, Symbol>, Speculation>::iterator it = speculations.find(key);
+	if(it != speculations.end())
+		return it->second;
+	Speculation& guess = speculations[key];
+	guess.cls = NULL;
+	guess.bound = NULL;
+	guess.print = 0;
+	if(!speculate || bound_class(type, name, false) != NULL)
+		return guess;
+	CgenNodeP node = node_index[type];
+	std::map<std::pair<Symbol, Symbol>, Symbol>::iterator seen = dispatch_profile.find(key);
+	if(seen != dispatch_profile.end() && node_index.count(seen->second)) {
+		for(CgenNodeP c = node_index[seen->second]; c != NULL && guess.cls == NULL; c = c->get_parentnd()) {
+			if(c == node)
+				guess.cls = node_index[seen->second];
+		}
+	}
+	if(guess.cls == NULL) {
+		int most = 0;
+		most_made(node, new_sites, most, guess.cls);
+		if(guess.cls == NULL)
+			return guess;
+	}
+	guess.bound = bound_class(guess.cls->get_name(), name, true);
+	int tag = guess.cls->get_tag();
+	guess.print = fingerprint(&tag, sizeof(tag), class_print(guess.cls));
+	guess.print = fingerprint(&guess.print, sizeof(guess.print), class_print(guess.bound));
+	uint64_t body = inline_target(guess.cls->get_name(), name, true).print;
+	guess.print = fingerprint(&body, sizeof(body), guess.print);
+	return guess;
+}
+
+//The call of name, at offset in the dispatch table, on $a0 with its
+//arguments coded and held of them in slots: straight to the method of
+//guess if $a0 has its class.
+static void emit_speculative_call(const Speculation& guess, Symbol name, int offset, int nargs, int nreg,
+		int held, bool on_self, CgenNode* current_node, ostream& s) {
+	int miss = current_node->new_label();
+	int done = current_node->new_label();
+	emit_load(T2, TAG_OFFSET, ACC, s);
+	emit_held_arguments(held, s);
+	emit_load_imm(T3, guess.cls->get_tag(), s);
+	emit_bne(T2, T3, miss, s);
+	const InlineTarget& target = current_node->get_class_table()->inline_target(guess.cls->get_name(), name, true);
+	if(target.cls != NULL && !inlining && nreg == 0) {
+		int temps = frame_temps;
+		emit_inlined_call(target, nargs, on_self, false, s);
+		frame_temps = temps;
+		speculative_inlined++;
+	} else {
+		s << JAL;
+		emit_method_ref(guess.bound->get_name(), name, s);
+		s << endl;
+	}
+	emit_label_def(done, s);
+	emit_label_def(miss, out_of_line);
+	emit_load(T1, DISPTABLE_OFFSET, ACC, out_of_line);
+	emit_load(T1, offset, T1, out_of_line);
+	emit_jalr(T1, out_of_line);
+	emit_branch(done, out_of_line);
+	speculative_calls++;
+}
+
 void CgenNode::code_initializer(ostream& s) {
+	label_class = name;
+	label_node = this;
 	s << get_name() << CLASSINIT_SUFFIX << LABEL;
-	emit_push(FP,s); 			//store the frame pointer $fp
-	emit_push(SELF,s);			//store the self pointer $self
-	emit_push(RA,s);			//store the return address $ra
-
-	emit_addiu(FP,SP,4,s);		//set the new frame pointer $fp. but why this value?
-	//emit_move(FP,SP,s);
+	unreachable = false;
+	line_class = this;
+	FrameUse use(this);
+	use.self = true;
+	use.calls = get_name() != Object;
+	for(int i = features->first(); features->more(i); i = features->next(i)) {
+		attr_class* attr = dynamic_cast<attr_class*>(features->nth(i));
+		if(attr != NULL && attr->init->get_type())
+			attr->init->frame_use(use);
+	}
+	emit_prologue(use, s);
+	frame_statistics(name, NULL);
 	emit_move(SELF,ACC,s);		//set $self to the prototype object in ACC.
 	if(get_name() != Object) {
 		s << JAL;				//initialize parent class. No need for Object class.
@@ -976,64 +2279,110 @@ void CgenNode::code_initializer(ostream& s) {
 			//If init expression does not exist, get_type() == NULL. This is not the same
 			//as my own implementation of semant.
 			if(attr->init->get_type()) {
+				NonVoid known;
+				value_nonvoid(attr->init, known);
 				//This will put the result of the init expression in ACC
 				attr->init->code(s, this, class_table->get_frame_env());
 				//Store the value of the init expression at the correct position
-				emit_store(ACC,*attr_offset->probe(attr->name),SELF,s);
+				emit_store(ACC,get_attr_offset(attr->name),SELF,s);
 			}
 		}
 	}
 	emit_move(ACC,SELF,s);	//The initialized object should be saved in ACC
-	emit_load(FP,3,SP,s);	//Retrieve old $fp, $self and $ra.
-	emit_load(SELF,2,SP,s);
-	emit_load(RA,1,SP,s);
-	emit_addiu(SP,SP,12,s);	//Restore $sp
-	emit_return(s);			//return
+	emit_epilogue(0, s);
+	s << out_of_line.str();
+	out_of_line.str("");
 }
 //
+void CgenNode::code_method(method_class* method, ostream& s) {
+	if(cgen_debug) {
+		cout << "\t\tcoding for ";
+		emit_method_ref(name, method->name, cout);
+		cout << endl;
+	}
+	emit_method_ref(name,method->name,s);
+	s  << LABEL;
+
+	find_void_checks(method);
+	mark_tail_calls(method->expr);
+	int nargs = method->formals->len();
+	int nreg = register_arguments(this, name, method->name, nargs);
+	//tail calls of the method itself loop back
+	coded_method = method;
+	line_class = this;
+	while(line_class->find_method(method->name) != method)
+		line_class = line_class->get_parentnd();
+	FrameUse use(this);
+	for(int i = method->formals->first(); method->formals->more(i); i = method->formals->next(i))
+		use.locals.insert(dynamic_cast<formal_class*>(method->formals->nth(i))->name);
+	method->expr->frame_use(use);
+	//register arguments would not live through a call: they get the first slots
+	bool spill = nreg > 0 && use.calls;
+	if(spill)
+		use.size += nreg;
+	emit_prologue(use, s);
+	frame_statistics(name, method->name);
+	frame_depth = spill ? nreg : 0;
+
+	//Put all formals in the frame_env
+	class_table->get_frame_env()->enterscope();
+	//offset of the first arg on the stack: above the saved registers
+	int offset = nargs - nreg + frame_saved - 1;
+	for(int i = method->formals->first(); method->formals->more(i); i = method->formals->next(i)) {
+		formal_class* formal = dynamic_cast<formal_class*>(method->formals->nth(i));
+		int slot;
+		if(i >= nreg)
+			slot = offset--;
+		else if(spill)
+			slot = -(i + 1);
+		else {
+			slot = nargs - nreg + frame_saved + i;	//above the others, but only a name
+			slot_regs[slot] = arg_regs[i];
+		}
+		class_table->get_frame_env()->addid(formal->name, arena_new<int>(slot));
+	}
+	coded_args = nargs - nreg;
+	tail_entry = -1;
+	unreachable = false;
+	std::ostringstream body;
+	method->expr->code(body, this, class_table->get_frame_env());
+	class_table->get_frame_env()->exitscope();
+
+	//calls of the method in tail position loop back to here
+	if(tail_entry >= 0)
+		emit_label_def(tail_entry, s);
+	for(int i = 0; spill && i < nreg; i++)
+		emit_store_slot(arg_regs[i], -(i + 1), s);
+	register_arguments_spilled += spill ? nreg : 0;
+	//In dispatch_class, the value of expr is saved in ACC. During the execution of
+	//the method, SELF should use this value.
+	if(frame_self)
+		emit_move(SELF,ACC,s);
+	s << body.str();
+
+	emit_epilogue(nargs - nreg, s);
+	s << out_of_line.str();
+	out_of_line.str("");
+}
+
 void CgenNode::code_methods(ostream& s) {
+	label_class = name;
+	label_node = this;
 	for(int i = features->first(); features->more(i); i = features->next(i)) {
 		Feature f = features->nth(i);
-		if(f->get_feature_type() == FEATURE_METHOD) {
-			method_class* method = dynamic_cast<method_class*>(f);
-			if(cgen_debug) {
-				cout << "\t\tcoding for ";
-				emit_method_ref(name, method->name, cout);
-				cout << endl;
-			}
-			emit_method_ref(name,method->name,s);
-			s  << LABEL;
-
-			emit_push(FP,s); 			//store the frame pointer $fp
-			emit_push(SELF,s);			//store the self pointer $self
-			emit_push(RA,s);			//store the return address $ra
-
-			//set up $fp
-			emit_addiu(FP,SP,4,s);		//set the new frame pointer $fp. but why this value?
-			//emit_move(FP,SP,s);
-
-			//In dispatch_class, the value of expr is saved in ACC. During the execution of
-			//the method, SELF should use this value.
-			emit_move(SELF,ACC,s);
-
-			//Put all formals in the frame_env
-			class_table->get_frame_env()->enterscope();
-			//offset of the first arg: len + 2 (fp + self)
-			int offset = method->formals->len() + 2;
-			for(int i = method->formals->first(); method->formals->more(i); i = method->formals->next(i)) {
-				formal_class* formal = dynamic_cast<formal_class*>(method->formals->nth(i));
-				class_table->get_frame_env()->addid(formal->name, new int(offset--));
-			}
-			method->expr->code(s, this, class_table->get_frame_env());
-			class_table->get_frame_env()->exitscope();
-
-			emit_load(FP,3,SP,s);	//Retrieve old $fp, $self and $ra.
-			emit_load(SELF,2,SP,s);
-			emit_load(RA,1,SP,s);
-			emit_addiu(SP,SP,12 + 4 * method->formals->len(),s);	//Restore $sp
-			emit_return(s);			//return
-		}
+		if(f->get_feature_type() == FEATURE_METHOD)
+			code_method(dynamic_cast<method_class*>(f), s);
 	}
+	cloning = true;
+	for(size_t i = 0; i < clones.size(); i++)
+		code_method(clones[i], s);
+	cloning = false;
+	if(customize > 0)
+		note_fact(FACT_CLONES, name, NULL, clones_print);
+}
+
+int CgenNode::new_label() {
+	return label_node->labels++;
 }
 
 int CgenNode::get_method_offset(Symbol type, Symbol name) {
@@ -1041,6 +2390,7 @@ int CgenNode::get_method_offset(Symbol type, Symbol name) {
 	assert(node);
 	int* offset = node->method_offset->lookup(name);
 	assert(offset);
+	note_fact(FACT_METHOD, node->get_name(), name, *offset);
 	return *offset;
 }
 
@@ -1050,6 +2400,7 @@ int CgenNode::get_attr_offset(Symbol name) {
 		cout << this->name << "." << name << endl;
 	}
 	assert(offset);
+	note_fact(FACT_ATTR, this->name, name, *offset);
 	return *offset;
 }
 
@@ -1071,7 +2422,10 @@ void CgenClassTable::code_initializers() {
 	for(List<CgenNode>* l = nds; l; l = l->tl()) {
 		CgenNode* node = l->hd();
 		if(cgen_debug) cout << "\tcoding initializer for class " << node->get_name() << endl;
-		node->code_initializer(str);
+		if(cache_path && !node->basic())
+			code_class_cached(node);	//its methods too
+		else
+			node->code_initializer(str);
 	}
 
 }
@@ -1081,33 +2435,360 @@ void CgenClassTable::code_class_methods() {
 		CgenNode* node = l->hd();
 		if(node->basic()) continue;
 		if(cgen_debug) cout << "\tcoding methods for class " << node->get_name() << endl;
-		node->code_methods(str);
+		if(cache_path)
+			str << methods_code[node->get_name()];
+		else
+			node->code_methods(str);
 	}
 }
 
+//The exception handler of implicit void checks.  A fault at a load in
+//_void_sites resumes at the stub of the load; any other exception is
+//reported with its code and ends the program, and an interrupt resumes
+//where it was taken.  $at, $t1, $t2 and $t3 are kept for the program;
+//$k0 and $k1 are the kernel's.
+void CgenClassTable::code_void_trap() {
+	str << "\t.kdata" << endl
+		<< "_void_sites_end" << LABEL
+		<< "_void_trap_save" << LABEL
+		<< WORD << 0 << endl << WORD << 0 << endl << WORD << 0 << endl
+		<< "_void_trap_exception" << LABEL
+		<< "\t.asciiz\t\"  Exception \"" << endl
+		<< "_void_trap_halted" << LABEL
+		<< "\t.asciiz\t\" occurred and halted the program\\n\"" << endl
+		<< "\t.ktext\t0x80000180" << endl
+		<< "\t.set\tnoat" << endl
+		<< "\tmove\t$k1 $at" << endl
+		<< "\t.set\tat" << endl
+		<< "\tsw\t$t1 _void_trap_save" << endl
+		<< "\tsw\t$t2 _void_trap_save+4" << endl
+		<< "\tsw\t$t3 _void_trap_save+8" << endl
+		<< "\tmfc0\t$k0 $14" << endl			//EPC, the faulting instruction
+		<< "\tla\t$t1 _void_sites" << endl
+		<< "\tla\t$t2 _void_sites_end" << endl
+		<< "_void_trap_next" << LABEL
+		<< "\tbeq\t$t1 $t2 _void_trap_other" << endl
+		<< "\tlw\t$t3 0($t1)" << endl
+		<< "\tbeq\t$t3 $k0 _void_trap_found" << endl
+		<< "\taddiu\t$t1 $t1 8" << endl
+		<< "\tb\t_void_trap_next" << endl
+		<< "_void_trap_found" << LABEL
+		<< "\tlw\t$k0 4($t1)" << endl
+		<< "\tb\t_void_trap_return" << endl
+		<< "_void_trap_other" << LABEL
+		<< "\tmfc0\t$t1 $13" << endl			//Cause
+		<< "\tandi\t$t1 $t1 0x7c" << endl
+		<< "\tbeqz\t$t1 _void_trap_return" << endl
+		<< "\tli\t$v0 4" << endl
+		<< "\tla\t$a0 _void_trap_exception" << endl
+		<< "\tsyscall" << endl
+		<< "\tli\t$v0 1" << endl
+		<< "\tsrl\t$a0 $t1 2" << endl
+		<< "\tsyscall" << endl
+		<< "\tli\t$v0 4" << endl
+		<< "\tla\t$a0 _void_trap_halted" << endl
+		<< "\tsyscall" << endl
+		<< "\tli\t$v0 10" << endl
+		<< "\tsyscall" << endl
+		<< "_void_trap_return" << LABEL
+		<< "\tmtc0\t$k0 $14" << endl
+		<< "\tlw\t$t1 _void_trap_save" << endl
+		<< "\tlw\t$t2 _void_trap_save+4" << endl
+		<< "\tlw\t$t3 _void_trap_save+8" << endl
+		<< "\t.set\tnoat" << endl
+		<< "\tmove\t$at $k1" << endl
+		<< "\t.set\tat" << endl
+		<< "\tmtc0\t$0 $13" << endl			//clear Cause
+		<< "\tmfc0\t$k0 $12" << endl			//leave exception level
+		<< "\tandi\t$k0 $k0 0xfffd" << endl
+		<< "\tori\t$k0 $k0 0x1" << endl
+		<< "\tmtc0\t$k0 $12" << endl
+		<< "\teret" << endl;
+}
+
+void CgenClassTable::code_abort_stubs() {
+	for(std::map<std::string, AbortStub>::iterator it = abort_stubs.begin(); it != abort_stubs.end(); ++it) {
+		str << it->first << LABEL;
+		emit_load_string(ACC, it->second.file, str);
+		emit_load_imm(T1, it->second.line, str);
+		if(it->second.kind == 'D')
+			emit_jal(DISPATCH_ABORT, str);
+		else
+			emit_jal(CASE_ABORT2, str);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Incremental code generation (cgen-cache.h)
+//
+//////////////////////////////////////////////////////////////////////
+
+static uint64_t fingerprint_symbol(Symbol s, uint64_t h) {
+	return fingerprint(s->get_string(), s->get_len() + 1, h);
+}
+
+uint64_t CgenClassTable::classes_fingerprint() {
+	if(classes_print == 0) {
+		uint64_t h = FINGERPRINT_INIT;
+		for(List<CgenNode>* l = nds; l; l = l->tl()) {
+			int tag = l->hd()->get_tag();
+			h = fingerprint_symbol(l->hd()->get_name(), h);
+			h = fingerprint_symbol(l->hd()->get_parent(), h);
+			h = fingerprint(&tag, sizeof(tag), h);
+		}
+		classes_print = h;
+	}
+	return classes_print;
+}
+
+bool CgenClassTable::facts_hold(const CachedCode& code) {
+	for(size_t i = 0; i < code.facts.size(); i++) {
+		const CgenFact& f = code.facts[i];
+		uint64_t now;
+		if(f.kind == FACT_ATTR || f.kind == FACT_METHOD) {
+			std::map<Symbol, CgenNodeP>::iterator it = node_index.find(f.cls);
+			if(it == node_index.end())
+				return false;
+			int* offset = f.kind == FACT_ATTR ? it->second->find_attr_offset(f.name) :
+					it->second->find_method_offset(f.name);
+			if(offset == NULL)
+				return false;
+			now = *offset;
+		} else if(f.kind == FACT_BOUND || f.kind == FACT_BOUND_STATIC) {
+			if(node_index.find(f.cls) == node_index.end())
+				return false;
+			now = class_print(bound_class(f.cls, f.name, f.kind == FACT_BOUND_STATIC));
+		} else if(f.kind == FACT_CLONES || f.kind == FACT_SLOT) {
+			if(node_index.find(f.cls) == node_index.end())
+				return false;
+			CgenNodeP node = node_index[f.cls];
+			now = f.kind == FACT_CLONES ? node->get_clones_print() : class_print(slot_class(node, f.name));
+		} else if(f.kind == FACT_GUESS) {
+			if(node_index.find(f.cls) == node_index.end())
+				return false;
+			now = speculation(f.cls, f.name).print;
+		} else if(f.kind == FACT_ROOT) {
+			if(node_index.find(f.cls) == node_index.end())
+				return false;
+			now = class_print(root_class(node_index[f.cls], f.name));
+		} else if(f.kind == FACT_INLINE || f.kind == FACT_INLINE_STATIC) {
+			if(node_index.find(f.cls) == node_index.end())
+				return false;
+			now = inline_target(f.cls, f.name, f.kind == FACT_INLINE_STATIC).print;
+		} else {
+			now = classes_fingerprint();
+		}
+		if(now != f.value)
+			return false;
+	}
+	return true;
+}
+
+static bool operator<(const CgenFact& a, const CgenFact& b) {
+	if(a.kind != b.kind) return a.kind < b.kind;
+	if(a.cls != b.cls) return a.cls < b.cls;
+	return a.name < b.name;
+}
+
+static bool operator==(const CgenFact& a, const CgenFact& b) {
+	return a.kind == b.kind && a.cls == b.cls && a.name == b.name;
+}
+
+//The labels of constants in this program; false if one is not in it.
+static bool constant_labels(const std::vector<std::string>& constants, std::vector<std::string>& labels) {
+	static std::map<std::string, std::string> known;
+	std::string stub;
+	labels.clear();
+	for(size_t i = 0; i < constants.size(); i++) {
+		const std::string& key = constants[i];
+		std::map<std::string, std::string>::iterator it = known.find(key);
+		if(it == known.end()) {
+			char* text = (char*) key.c_str() + 1;
+			std::ostringstream label;
+			if(key[0] == 'S' && stringtable.lookup_string(text) != NULL)
+				stringtable.lookup_string(text)->code_ref(label);
+			else if(key[0] == 'I' && inttable.lookup_string(text) != NULL)
+				inttable.lookup_string(text)->code_ref(label);
+			else if((key[0] == 'D' || key[0] == 'C') && abort_stub_label(key, stub))
+				label << stub;
+			else
+				return false;
+			it = known.insert(std::make_pair(key, label.str())).first;
+		}
+		labels.push_back(it->second);
+	}
+	return true;
+}
+
+bool CgenClassTable::move_abort_lines(std::vector<std::string>& constants, int sign) {
+	for(size_t i = 0; i < constants.size(); i++) {
+		std::string& key = constants[i];
+		if(key[0] != 'D' && key[0] != 'C')
+			continue;
+		size_t at = key.find('@'), colon = key.find(':');
+		std::string owner = key.substr(at + 1, colon - at - 1);
+		Symbol name = idtable.lookup_string((char*) owner.c_str());
+		std::map<Symbol, CgenNodeP>::iterator it = node_index.find(name);
+		if(name == NULL || it == node_index.end())
+			return false;
+		std::ostringstream moved;
+		moved << key[0] << atoi(key.c_str() + 1) + sign * it->second->get_source()->get_line_number()
+				<< key.substr(at);
+		key = moved.str();
+	}
+	return true;
+}
+
+//code with its constant markers replaced by labels.
+static void link_code(const std::string& code, const std::vector<std::string>& labels, ostream& s) {
+	size_t at = 0, marker;
+	while((marker = code.find('\001', at)) != std::string::npos) {
+		size_t close = code.find('\001', marker + 1);
+		s.write(code.data() + at, marker - at);
+		s << labels[atoi(code.c_str() + marker + 1)];
+		at = close + 1;
+	}
+	s.write(code.data() + at, code.size() - at);
+}
+
+//The counters the code of a class adds to, by the statistic they are
+//reported as.  The clones are chosen before any class is coded, so their
+//counts are not here.
+static struct { const char* name; long* count; } class_counters[] = {
+	{ "cgen.void_checks_kept", &void_checks_kept },
+	{ "cgen.void_checks_implicit", &void_checks_implicit },
+	{ "cgen.void_checks_removed", &void_checks_removed },
+	{ "cgen.inlined_calls", &inlined_calls },
+	{ "cgen.tail_calls", &tail_calls },
+	{ "cgen.tail_loops", &tail_loops },
+	{ "cgen.frames", &frames },
+	{ "cgen.frames_without_fp", &frames_without_fp },
+	{ "cgen.frames_without_s0", &frames_without_self },
+	{ "cgen.frames_without_ra", &frames_without_ra },
+	{ "cgen.register_arguments", &register_arguments_passed },
+	{ "cgen.register_arguments_spilled", &register_arguments_spilled },
+	{ "cgen.speculative_calls", &speculative_calls },
+	{ "cgen.speculative_inlined", &speculative_inlined },
+	{ "cgen.direct_self_calls", &direct_self_calls }
+};
+#define CLASS_COUNTERS (sizeof(class_counters) / sizeof(class_counters[0]))
+
+//Adds what the code of a class from the cache added to the statistics.
+static void replay_statistics(const CachedCode& code) {
+	for(size_t i = 0; i < code.statistics.size(); i++) {
+		const std::pair<std::string, long>& st = code.statistics[i];
+		size_t c = 0;
+		while(c < CLASS_COUNTERS && st.first != class_counters[c].name)
+			c++;
+		if(c < CLASS_COUNTERS)
+			*class_counters[c].count += st.second;
+		else
+			pass_statistic(st.first.c_str(), st.second);
+	}
+}
+
+//Emits the initializer of nd and keeps its methods for code_class_methods,
+//from the cache if nothing they were made from has changed.
+void CgenClassTable::code_class_cached(CgenNodeP nd) {
+	//the code also depends on the way void is checked, on the collector
+	//(frames are cleared for it), on the budgets, on the number of register
+	//arguments and on speculation
+	uint64_t tree = fingerprint(&implicit_void_checks, sizeof(implicit_void_checks),
+			class_records_fingerprint(nd->get_source()));
+	tree = fingerprint(&cgen_Memmgr, sizeof(cgen_Memmgr), tree);
+	tree = fingerprint(&inline_budget, sizeof(inline_budget), tree);
+	tree = fingerprint(&register_args, sizeof(register_args), tree);
+	tree = fingerprint(&speculate, sizeof(speculate), tree);
+	tree = fingerprint(&customize, sizeof(customize), tree);
+	const CachedCode* hit = old_cache.find(nd->get_name());
+	std::vector<std::string> constants, labels;
+	std::ostringstream methods;
+	if(hit != NULL)
+		constants = hit->constants;
+	if(hit != NULL && hit->tree == tree && facts_hold(*hit) && move_abort_lines(constants, 1)
+			&& constant_labels(constants, labels)) {
+		link_code(hit->init, labels, str);
+		link_code(hit->methods, labels, methods);
+		methods_code[nd->get_name()] = methods.str();
+		replay_statistics(*hit);
+		new_cache.add(nd->get_name(), *hit);
+		return;
+	}
+
+	recoded = true;
+	CachedCode code;
+	code.tree = tree;
+	std::ostringstream init, marked;
+	long counts[CLASS_COUNTERS];
+	for(size_t i = 0; i < CLASS_COUNTERS; i++)
+		counts[i] = *class_counters[i].count;
+	recording = &code;
+	recorded_constants.clear();
+	nd->code_initializer(init);
+	nd->code_methods(marked);
+	recording = NULL;
+	for(size_t i = 0; i < CLASS_COUNTERS; i++) {
+		if(*class_counters[i].count != counts[i])
+			code.statistics.push_back(std::make_pair(std::string(class_counters[i].name),
+					*class_counters[i].count - counts[i]));
+	}
+	std::sort(code.facts.begin(), code.facts.end());
+	code.facts.erase(std::unique(code.facts.begin(), code.facts.end()), code.facts.end());
+	code.init = init.str();
+	code.methods = marked.str();
+
+	bool linked = constant_labels(code.constants, labels);
+	assert(linked);
+	link_code(code.init, labels, str);
+	link_code(code.methods, labels, methods);
+	methods_code[nd->get_name()] = methods.str();
+	move_abort_lines(code.constants, -1);
+	new_cache.add(nd->get_name(), code);
+}
+
 void CgenClassTable::code()
 {
+  const char *implicit = getenv("COOL_IMPLICIT_VOID_CHECKS");
+  implicit_void_checks = implicit != NULL && *implicit != '\0' && strcmp(implicit, "0") != 0;
+  const char *budget = getenv("COOL_INLINE_BUDGET");
+  inline_budget = budget != NULL && *budget != '\0' ? atoi(budget) : DEFAULT_INLINE_BUDGET;
+  const char *regs = getenv("COOL_REGISTER_ARGS");
+  register_args = regs != NULL ? std::max(0, std::min(atoi(regs), MAX_REGISTER_ARGS)) : 0;
+  const char *spec = getenv("COOL_SPECULATE");
+  const char *profile = getenv("COOL_DISPATCH_PROFILE");
+  speculate = spec != NULL && *spec != '\0' && strcmp(spec, "0") != 0;
+  if (profile != NULL && *profile != '\0') {
+    if (!read_dispatch_profile(profile))
+      cerr << "cgen: cannot read dispatch profile " << profile << endl;
+    speculate = true;
+  }
+  if (speculate) count_new_sites();
+  const char *custom = getenv("COOL_CUSTOMIZE");
+  customize = custom != NULL ? std::max(0, atoi(custom)) : 0;
+  if (customize > 0) { PassTimer pass("cgen.choose_clones"); choose_clones(); }
+
   if (cgen_debug) cout << "coding global data" << endl;
-  code_global_data();
+  { PassTimer pass("cgen.global_data"); code_global_data(); }
 
   if (cgen_debug) cout << "choosing gc" << endl;
-  code_select_gc();
+  { PassTimer pass("cgen.select_gc"); code_select_gc(); }
 
   if (cgen_debug) cout << "coding constants" << endl;
-  code_constants();
+  { PassTimer pass("cgen.constants"); code_constants(); }
 
   ////////////////////////////////////////////////////////////////////
   if (cgen_debug) cout << "coding class name table" << endl;
-  code_class_nameTab();
+  { PassTimer pass("cgen.nameTab"); code_class_nameTab(); }
 
   if (cgen_debug) cout << "coding class object table" << endl;
-  code_class_objTab();
+  { PassTimer pass("cgen.objTab"); code_class_objTab(); }
 
   if (cgen_debug) cout << "coding class dispatch table" << endl;
-  code_dispTabs();
+  { PassTimer pass("cgen.dispTabs"); code_dispTabs(); }
 
   if (cgen_debug) cout << "coding prototype objects" << endl;
-  code_protObjs();
+  { PassTimer pass("cgen.protObjs"); code_protObjs(); }
 
 
 //                 Add your code to emit
@@ -1117,13 +2798,28 @@ void CgenClassTable::code()
 //
 
   if (cgen_debug) cout << "coding global text" << endl;
-  code_global_text();
+  { PassTimer pass("cgen.global_text"); code_global_text(); }
+
+  if (cache_path) { PassTimer pass("cgen.load_cache"); old_cache.load(cache_path); }
 
   if (cgen_debug) cout << "coding object initializer" << endl;
-  code_initializers();
+  { PassTimer pass("cgen.initializers"); code_initializers(); }
 
   if (cgen_debug) cout << "coding class methods" << endl;
-  code_class_methods();
+  { PassTimer pass("cgen.methods"); code_class_methods(); }
+
+  if (cgen_debug) cout << "coding aborts on void" << endl;
+  { PassTimer pass("cgen.abort_stubs"); code_abort_stubs(); }
+  if (void_checks_implicit > 0) code_void_trap();
+  for (size_t i = 0; i < CLASS_COUNTERS; i++)
+    pass_statistic(class_counters[i].name, *class_counters[i].count);
+  pass_statistic("cgen.clones", clones_made);
+  pass_statistic("cgen.clone_words", clone_words);
+
+  if (cache_path && (recoded || new_cache.size() != old_cache.size())) {
+    PassTimer pass("cgen.save_cache");
+    new_cache.save(cache_path);
+  }
 
 //                 Add your code to emit
 //                   - object initializer
@@ -1152,8 +2848,11 @@ CgenNode::CgenNode(Class_ nd, Basicness bstatus, CgenClassTableP ct, int t) :
    basic_status(bstatus),
    class_table(ct),
    tag(t),
-   attr_offset(new SymbolTable<Symbol, int>()),
-   method_offset(new SymbolTable<Symbol, int>())
+   attr_offset(arena_new<SymbolTable<Symbol, int> >()),
+   method_offset(arena_new<SymbolTable<Symbol, int> >()),
+   source(nd),
+   labels(0),
+   clones_print(0)
 { 
    stringtable.add_string(name->get_string());          // Add class name to string table
    attr_offset->enterscope();
@@ -1175,76 +2874,141 @@ void assign_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol,
 	expr->code(s, current_node, frame_env);
 	int* frame_offset = frame_env->lookup(name);
 	if(frame_offset != NULL) {
-		emit_store(ACC, *frame_offset, FP, s);
+		emit_store_slot(ACC, *frame_offset, s);
 	} else {
 		emit_store(ACC, current_node->get_attr_offset(name), SELF, s);
 	}
 }
 
 void static_dispatch_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env) {
-	for(int i = actual->first(); actual->more(i); i = actual->next(i)) {
-		Expression ei = actual->nth(i);
-		ei->code(s, current_node, frame_env);
-		emit_push(ACC, s);
+	bool tail_call = tail && (!inlining || inlining_tail);
+	bool loop = tail_call && calls_coded_method(current_node, type_name, name, true);
+	const InlineTarget* target = NULL;
+	if(!inlining) {
+		target = &current_node->get_class_table()->inline_target(type_name, name, true);
+		note_fact(FACT_INLINE_STATIC, type_name, name, target->print);
 	}
+	bool inlined = target != NULL && target->cls != NULL && !loop;
+	int nreg = inlined ? 0 : register_arguments(current_node, type_name, name, actual->len());
+	int held = emit_arguments(actual, expr, nreg, current_node, frame_env, s);
 	expr->code(s, current_node, frame_env);
-	int branch_label = i_label++;
-	emit_bne(ACC, ZERO, branch_label, s);
-
-	//handle dispatch on void
-	//name of current file in $a0
-	emit_load_string(ACC, stringtable.lookup_string(current_node->filename->get_string()), s);
-	//current line number in $t1
-	emit_load_imm(T1,curr_lineno,s);
-	emit_jal(DISPATCH_ABORT,s);
+	//dispatch on void
+	emit_void_check(check_void, false, 'D', current_node, get_line_number(), s);
+	if(loop) {
+		emit_held_arguments(held, s);
+		emit_tail_loop(current_node, actual->len() - nreg, s);
+		frame_temps -= actual->len() - nreg;
+		return;
+	}
+	if(inlined) {
+		emit_inlined_call(*target, actual->len(), is_self(expr), tail_call, s);
+		return;
+	}
 
 	//execute dispatch
-	emit_label_def(branch_label,s);
-	//load dispTab of type_name
-	s << LA << T1 << "\t";
-	emit_disptable_ref(type_name, s);
-	s << endl;
-	emit_load(T1,current_node->get_method_offset(type_name, name),T1,s);
-	emit_jalr(T1,s);
+	if(customize > 0) {
+		//the table of type_name may hold a clone, which is for that class only
+		CgenNodeP cls = current_node->get_class_table()->bound_class(type_name, name, true);
+		note_fact(FACT_BOUND_STATIC, type_name, name, class_print(cls));
+		s << LA << T1 << "\t";
+		emit_method_ref(cls->get_name(), name, s);
+		s << endl;
+	} else {
+		//load dispTab of type_name
+		s << LA << T1 << "\t";
+		emit_disptable_ref(type_name, s);
+		s << endl;
+		emit_load(T1,current_node->get_method_offset(type_name, name),T1,s);
+	}
+	emit_held_arguments(held, s);
+	if(tail_call && tail_call_fits(actual->len() - nreg))
+		emit_tail_call(actual->len() - nreg, s);
+	else
+		emit_jalr(T1,s);
+	frame_temps -= actual->len() - nreg;	//the callee pops the arguments
 }
 
 void dispatch_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env) {
 	if(cgen_debug) {
 		cout << "\t\t\tcoding " << expr->type << "." << name << " inside " << current_node->name << endl;
 	}
-	for(int i = actual->first(); actual->more(i); i = actual->next(i)) {
-		Expression ei = actual->nth(i);
-		ei->code(s, current_node, frame_env);
-		emit_push(ACC, s);
+	Symbol type = expr->get_type() == SELF_TYPE ? current_node->get_name() : expr->get_type();
+	bool exact = exact_receiver(expr, inlining);
+	bool tail_call = tail && (!inlining || inlining_tail);
+	//a clone is only for receivers of its class
+	bool loop = tail_call && (exact || !cloning) && calls_coded_method(current_node, type, name, exact);
+	const InlineTarget* target = NULL;
+	if(!inlining) {
+		target = &current_node->get_class_table()->inline_target(type, name, exact);
+		note_fact(exact ? FACT_INLINE_STATIC : FACT_INLINE, type, name, target->print);
 	}
+	bool inlined = target != NULL && target->cls != NULL && !loop;
+	int nreg = inlined ? 0 : register_arguments(current_node, type, name, actual->len());
+	int held = emit_arguments(actual, expr, nreg, current_node, frame_env, s);
 	expr->code(s, current_node, frame_env);
-	int branch_label = i_label++;
-	emit_bne(ACC, ZERO, branch_label, s);
-
-	//handle dispatch on void
-	//name of current file in $a0
-	emit_load_string(ACC, stringtable.lookup_string(current_node->filename->get_string()), s);
-	//current line number in $t1
-	emit_load_imm(T1,curr_lineno,s);
-	emit_jal(DISPATCH_ABORT,s);
+	//dispatch on void
+	emit_void_check(check_void, !inlined && !loop, 'D', current_node, get_line_number(), s);
+	if(loop) {
+		emit_held_arguments(held, s);
+		emit_tail_loop(current_node, actual->len() - nreg, s);
+		frame_temps -= actual->len() - nreg;
+		return;
+	}
+	if(inlined) {
+		emit_inlined_call(*target, actual->len(), is_self(expr), tail_call, s);
+		return;
+	}
+	if(exact) {
+		CgenNodeP slot = slot_class(current_node, name);
+		note_fact(FACT_SLOT, type, name, class_print(slot));
+		emit_held_arguments(held, s);
+		if(tail_call && tail_call_fits(actual->len() - nreg)) {
+			s << LA << T1 << "\t";
+			emit_method_ref(slot->get_name(), name, s);
+			s << endl;
+			emit_tail_call(actual->len() - nreg, s);
+		} else {
+			s << JAL;
+			emit_method_ref(slot->get_name(), name, s);
+			s << endl;
+		}
+		direct_self_calls++;
+		frame_temps -= actual->len() - nreg;
+		return;
+	}
+	if(speculate && !tail_call) {
+		const Speculation& guess = current_node->get_class_table()->speculation(type, name);
+		note_fact(FACT_GUESS, type, name, guess.print);
+		if(guess.cls != NULL) {
+			emit_speculative_call(guess, name, current_node->get_method_offset(expr->get_type(), name),
+					actual->len(), nreg, held, is_self(expr), current_node, s);
+			frame_temps -= actual->len() - nreg;
+			return;
+		}
+	}
 
 	//execute dispatch
-	emit_label_def(branch_label,s);
 	//load dispTab of expr
 	emit_load(T1,DISPTABLE_OFFSET,ACC,s);
 	emit_load(T1,current_node->get_method_offset(expr->get_type(), name),T1,s);
-	emit_jalr(T1,s);
+	emit_held_arguments(held, s);
+	if(tail_call && tail_call_fits(actual->len() - nreg))
+		emit_tail_call(actual->len() - nreg, s);
+	else
+		emit_jalr(T1,s);
+	frame_temps -= actual->len() - nreg;	//the callee pops the arguments
 }
 
 void cond_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env) {
 	pred->code(s, current_node, frame_env);
 	emit_load_bool(T1,truebool,s);
-	int true_branch = i_label++;
-	int end_branch = i_label++;
+	int true_branch = current_node->new_label();
+	int end_branch = current_node->new_label();
 
 	emit_beq(ACC,T1,true_branch, s);
 	else_exp->code(s, current_node, frame_env);
-	emit_branch(end_branch, s);
+	if(!unreachable)
+		emit_branch(end_branch, s);
 
 	emit_label_def(true_branch, s);
 	then_exp->code(s, current_node, frame_env);
@@ -1253,14 +3017,14 @@ void cond_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, in
 }
 
 void loop_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env) {
-	int init_branch = i_label++;
+	int init_branch = current_node->new_label();
 	emit_label_def(init_branch,s);
 
 	pred->code(s, current_node, frame_env);
 
 	emit_load_bool(T1,truebool,s);
-	int true_branch = i_label++;
-	int end_branch = i_label++;
+	int true_branch = current_node->new_label();
+	int end_branch = current_node->new_label();
 
 	emit_beq(ACC,T1,true_branch, s);
 	emit_branch(end_branch, s);
@@ -1275,41 +3039,39 @@ void loop_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, in
 
 void typcase_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env) {
 	expr->code(s, current_node, frame_env);
-	int non_void_branch = i_label++;
-	int end_branch = i_label++;
-	//case on void: _case_abort (predefined in runtime system)
-	emit_bne(ACC,ZERO,non_void_branch,s);
-	emit_load_imm(T1,curr_lineno,s);
-	emit_load_string(ACC,stringtable.lookup_string(current_node->filename->get_string()),s);
-	emit_jal(CASE_ABORT2,s);
+	int end_branch = current_node->new_label();
+	//case on void: _case_abort2 (predefined in runtime system)
+	emit_void_check(check_void, true, 'C', current_node, get_line_number(), s);
 
 	//dynamic type is not void
-	emit_label_def(non_void_branch,s);
 	//get the tag of its dynamic type. Ok to use T1 because there can only be one successful comparison.
 	//Even if T1 gets edited by expr->code(), no problem shall be caused because T1 is no longer needed.
 	//The only case in which T1 is needed later is the case of no match. T1 will not be editted in this case.
 	emit_load(T1,TAG_OFFSET,ACC,s);
 	//Generate code for all classes whose ancestors appear in the cases.
+	if(recording)
+		note_fact(FACT_CLASSES, NULL, NULL, current_node->get_class_table()->classes_fingerprint());
 	for(List<CgenNode>* l = current_node->get_class_table()->get_nds(); l; l = l->tl()) {
 		int closest_ancestor = current_node->get_closest_ancestor(l->hd()->name, cases);
 		if(closest_ancestor != NO_ANCESTOR) {
 			branch_class* branch = dynamic_cast<branch_class*>(cases->nth(closest_ancestor));
-			int label = i_label++;
+			int label = current_node->new_label();
 			emit_load_imm(T2,l->hd()->get_tag(),s);
 			emit_bne(T1,T2,label,s);
-			emit_push(ACC,s);
+			int slot = new_slot();
+			emit_store_slot(ACC, slot, s);
 			frame_env->enterscope();
-			frame_env->addid(branch->name, new int(-(++case_layer + let_class::let_layer)));
+			frame_env->addid(branch->name, arena_new<int>(slot));
 			branch->expr->code(s, current_node, frame_env);
 			frame_env->exitscope();
-			--case_layer;
-			emit_branch(end_branch,s);
+			free_slot();
+			if(!unreachable)
+				emit_branch(end_branch,s);
 			emit_label_def(label,s);
 		}
 	}
 	emit_jal(CASE_ABORT,s);
 	emit_label_def(end_branch,s);
-	emit_addiu(SP,SP,4,s);
 }
 
 int CgenNode::get_closest_ancestor(Symbol type, Cases cases){
@@ -1354,21 +3116,22 @@ void let_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int
 			emit_move(ACC,ZERO,s);
 		}
 	}
-	emit_push(ACC,s);
+	int slot = new_slot();
+	emit_store_slot(ACC, slot, s);
 	frame_env->enterscope();
-	frame_env->addid(identifier, new int(-(++let_layer + typcase_class::case_layer)));
+	frame_env->addid(identifier, arena_new<int>(slot));
 	body->code(s, current_node, frame_env);
 	frame_env->exitscope();
-	--let_layer;
-	emit_addiu(SP,SP,4,s);
+	free_slot();
 }
 
 void plus_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env) {
 	e1->code(s, current_node, frame_env);
-	emit_push(ACC,s);
+	int slot = new_slot();
+	emit_store_slot(ACC, slot, s);
 	e2->code(s, current_node, frame_env);
 	emit_jal(OBJECTCOPY,s);
-	emit_load(T1,1,SP,s);
+	emit_load_slot(T1, slot, s);
 
 	//load the int values
 	emit_fetch_int(T2,T1,s);
@@ -1379,15 +3142,16 @@ void plus_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, in
 
 	//store the int value in the object
 	emit_store_int(T1,ACC,s);
-	emit_addiu(SP,SP,4,s);
+	free_slot();
 }
 
 void sub_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env) {
 	e1->code(s, current_node, frame_env);
-	emit_push(ACC,s);
+	int slot = new_slot();
+	emit_store_slot(ACC, slot, s);
 	e2->code(s, current_node, frame_env);
 	emit_jal(OBJECTCOPY,s);
-	emit_load(T1,1,SP,s);
+	emit_load_slot(T1, slot, s);
 
 	//load the int values
 	emit_fetch_int(T2,T1,s);
@@ -1398,15 +3162,16 @@ void sub_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int
 
 	//store the int value in the object
 	emit_store_int(T1,ACC,s);
-	emit_addiu(SP,SP,4,s);
+	free_slot();
 }
 
 void mul_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env) {
 	e1->code(s, current_node, frame_env);
-	emit_push(ACC,s);
+	int slot = new_slot();
+	emit_store_slot(ACC, slot, s);
 	e2->code(s, current_node, frame_env);
 	emit_jal(OBJECTCOPY,s);
-	emit_load(T1,1,SP,s);
+	emit_load_slot(T1, slot, s);
 
 	//load the int values
 	emit_fetch_int(T2,T1,s);
@@ -1417,15 +3182,16 @@ void mul_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int
 
 	//store the int value in the object
 	emit_store_int(T1,ACC,s);
-	emit_addiu(SP,SP,4,s);
+	free_slot();
 }
 
 void divide_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env) {
 	e1->code(s, current_node, frame_env);
-	emit_push(ACC,s);
+	int slot = new_slot();
+	emit_store_slot(ACC, slot, s);
 	e2->code(s, current_node, frame_env);
 	emit_jal(OBJECTCOPY,s);
-	emit_load(T1,1,SP,s);
+	emit_load_slot(T1, slot, s);
 
 	//load the int values
 	emit_fetch_int(T2,T1,s);
@@ -1436,7 +3202,7 @@ void divide_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol,
 
 	//store the int value in the object
 	emit_store_int(T1,ACC,s);
-	emit_addiu(SP,SP,4,s);
+	free_slot();
 }
 
 void neg_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env) {
@@ -1451,12 +3217,13 @@ void neg_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int
 
 void lt_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env) {
 	e1->code(s, current_node, frame_env);
-	emit_push(ACC,s);
+	int slot = new_slot();
+	emit_store_slot(ACC, slot, s);
 	e2->code(s, current_node, frame_env);
-	emit_load(T1,1,SP,s);
+	emit_load_slot(T1, slot, s);
 
-	int true_branch = i_label++;
-	int end_branch = i_label++;
+	int true_branch = current_node->new_label();
+	int end_branch = current_node->new_label();
 
 	//load the int values
 	emit_fetch_int(T2,T1,s);
@@ -1474,18 +3241,19 @@ void lt_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>
 
 	//end_branch branch
 	emit_label_def(end_branch,s);
-	emit_addiu(SP,SP,4,s);
+	free_slot();
 
 }
 
 void eq_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env) {
 	e1->code(s, current_node, frame_env);
-	emit_push(ACC,s);
+	int slot = new_slot();
+	emit_store_slot(ACC, slot, s);
 	e2->code(s, current_node, frame_env);
-	emit_load(T1,1,SP,s);
+	emit_load_slot(T1, slot, s);
 
-	int true_branch = i_label++;
-	int end_branch = i_label++;
+	int true_branch = current_node->new_label();
+	int end_branch = current_node->new_label();
 
 	//if they are the same object return true
 	emit_beq(T1,ACC,true_branch,s);
@@ -1502,17 +3270,18 @@ void eq_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>
 
 	//end_branch branch
 	emit_label_def(end_branch,s);
-	emit_addiu(SP,SP,4,s);
+	free_slot();
 }
 
 void leq_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env) {
 	e1->code(s, current_node, frame_env);
-	emit_push(ACC,s);
+	int slot = new_slot();
+	emit_store_slot(ACC, slot, s);
 	e2->code(s, current_node, frame_env);
-	emit_load(T1,1,SP,s);
+	emit_load_slot(T1, slot, s);
 
-	int true_branch = i_label++;
-	int end_branch = i_label++;
+	int true_branch = current_node->new_label();
+	int end_branch = current_node->new_label();
 
 	//load the int values
 	emit_fetch_int(T2,T1,s);
@@ -1530,13 +3299,13 @@ void leq_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int
 
 	//end_branch branch
 	emit_label_def(end_branch,s);
-	emit_addiu(SP,SP,4,s);
+	free_slot();
 }
 
 void comp_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env) {
 	e1->code(s, current_node, frame_env);
-	int false_branch = i_label++;
-	int end_branch = i_label++;
+	int false_branch = current_node->new_label();
+	int end_branch = current_node->new_label();
 	//load the value in the bool object.
 	emit_load(ACC,DEFAULT_OBJFIELDS,ACC,s);
 	emit_beqz(ACC,false_branch,s);
@@ -1570,13 +3339,15 @@ void bool_const_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symb
 }
 
 void new__class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env) {
-	if(type_name != SELF_TYPE) {
+	//in a clone, self is of the class coded
+	Symbol type = type_name == SELF_TYPE && cloning && !inlining ? current_node->get_name() : type_name;
+	if(type != SELF_TYPE) {
 		emit_partial_load_address(ACC,s);
-		emit_protobj_ref(type_name,s);
+		emit_protobj_ref(type,s);
 		s << endl;
 		emit_jal(OBJECTCOPY,s);
 		s << JAL;
-		emit_init_ref(type_name,s);
+		emit_init_ref(type,s);
 		s << endl;
 	} else {
 		//address of class_objTab
@@ -1603,8 +3374,8 @@ void new__class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, in
 
 void isvoid_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env) {
 	e1->code(s, current_node, frame_env);
-	int true_branch = i_label++;
-	int end_branch = i_label++;
+	int true_branch = current_node->new_label();
+	int end_branch = current_node->new_label();
 	emit_beq(ACC,ZERO,true_branch,s);
 
 	emit_load_bool(ACC, falsebool, s);
@@ -1625,7 +3396,7 @@ void object_class::code(ostream &s, CgenNode* current_node, SymbolTable<Symbol,
 	} else {
 		int* frame_offset = frame_env->lookup(name);
 		if(frame_offset != NULL) {
-			emit_load(ACC, *frame_offset, FP, s);
+			emit_load_slot(ACC, *frame_offset, s);
 		} else {
 			emit_load(ACC, current_node->get_attr_offset(name), SELF, s);
 		}
@@ -3,7 +3,9 @@
 #include "emit.h"
 #include "cool-tree.h"
 #include "symtab.h"
+#include "cgen-cache.h"
 #include <map>
+#include <set>
 #include <vector>
 #include <utility>
 
@@ -17,6 +19,46 @@ typedef CgenClassTable *CgenClassTableP;
 class CgenNode;
 typedef CgenNode *CgenNodeP;
 
+//What the void check analysis knows at a point of a method: its locals in
+//scope (formals, let and case variables), and which of them cannot be void
+//there.  Attributes are never known: any call may assign them.
+struct NonVoid {
+   std::set<Symbol> locals;
+   std::set<Symbol> known;
+};
+
+//What the code of a method or initializer needs of its frame: whether it
+//calls and comes back ($ra is saved), uses self ($s0 is saved and set),
+//and makes tail calls ($fp is saved and set), and how many slots it
+//keeps values in at once.
+struct FrameUse {
+   CgenNodeP cls;                             // whose code it is
+   std::set<Symbol> locals;                   // formals and locals in scope
+   bool calls;
+   bool self;
+   bool fp;
+   bool inlined;                              // of a body inlined, whose calls are not inlined
+   bool tail;                                 // of a body inlined in tail position, whose tail calls are
+   int depth;                                 // slots in use
+   int size;                                  // most slots in use
+   FrameUse(CgenNodeP c) : cls(c), calls(false), self(false), fp(false), inlined(false),
+         tail(false), depth(0), size(0) { }
+};
+
+//A method whose body can take the place of the calls to it.
+struct InlineTarget {
+   CgenNodeP cls;                             // the class that defines it; NULL if not inlined
+   method_class* method;
+   uint64_t print;                            // of the class name and the body; 0 if not inlined
+};
+
+//The receiver a dispatch is guessed to have (see "Speculative dispatch").
+struct Speculation {
+   CgenNodeP cls;                             // NULL for no guess
+   CgenNodeP bound;                           // the class whose method cls runs
+   uint64_t print;                            // of cls, its tag and the method; 0 for no guess
+};
+
 class CgenClassTable : public SymbolTable<Symbol,CgenNode> {
 private:
    List<CgenNode> *nds;
@@ -58,6 +100,27 @@ private:
    void code_protObjs();
    void code_initializers();
    void code_class_methods();
+   void code_abort_stubs();
+   void code_void_trap();
+
+   // Incremental code generation (cgen-cache.h)
+   const char* cache_path;                    // COOL_CGEN_CACHE, or NULL
+   CgenCache old_cache, new_cache;
+   bool recoded;                              // some class was coded again
+   std::map<Symbol, std::string> methods_code; // of the classes, until they are emitted
+   std::map<Symbol, CgenNodeP> node_index;    // the classes, looked up in log time
+   uint64_t classes_print;                    // 0 until computed
+   int inline_budget;                         // COOL_INLINE_BUDGET
+   std::map<std::pair<Symbol, Symbol>, InlineTarget> inline_targets[2];
+   std::map<Symbol, int> new_sites;           // new expressions by the class they make
+   std::map<std::pair<Symbol, Symbol>, Speculation> speculations;
+   void count_new_sites();
+   void choose_clones();
+   void code_class_cached(CgenNodeP nd);
+   bool facts_hold(const CachedCode& code);
+   //Moves the line of each abort in constants by the line of the class it
+   //names, times sign; false if that class is not in the program.
+   bool move_abort_lines(std::vector<std::string>& constants, int sign);
 
 public:
    CgenClassTable(Classes, ostream& str);
@@ -66,6 +129,17 @@ public:
 ////////////////////////////////////////////////////////////////////////
    SymbolTable<Symbol, int>* get_frame_env() { return frame_env; }
    List<CgenNode>* get_nds() { return nds; }
+   //Fingerprint of the name, tag and parent of every class, in nds order.
+   uint64_t classes_fingerprint();
+   //The class whose method name every dispatch on type runs (exact: every
+   //static dispatch to type), or NULL if that depends on the receiver.
+   CgenNodeP bound_class(Symbol type, Symbol name, bool exact);
+   //The method every dispatch on a type to name runs (exact: every static
+   //dispatch to the type), if its body is within the inlining budget.
+   const InlineTarget& inline_target(Symbol type, Symbol name, bool exact);
+   //The class a receiver of a dispatch on type to name most likely has,
+   //if the method depends on it and speculation is on.
+   const Speculation& speculation(Symbol type, Symbol name);
 };
 
 
@@ -80,6 +154,10 @@ private:
    int tag;									  // tag of the class
    SymbolTable<Symbol, int>* attr_offset;	  // environment of attributes. map from name to offset.
    SymbolTable<Symbol, int>* method_offset;	  // map from method name to offset.
+   Class_ source;							  // the class as read, for its fingerprint
+   int labels;								  // labels made in the code of the class so far
+   std::vector<method_class*> clones;		  // inherited methods coded again for this class
+   uint64_t clones_print;					  // of the clones and the classes they come from
 
    std::pair<std::vector<Symbol>, std::map<Symbol,Symbol> > find_first_appearance_of_methods();
 public:
@@ -97,11 +175,22 @@ public:
    ////////////////////////////////////////////////////////////////////////
    int get_tag() { return tag; }
    CgenClassTableP get_class_table() { return class_table; }
+   Class_ get_source() { return source; }
+   //a new label of the code being made: of the class coded, which is not
+   //this one in a method inlined from this class.
+   int new_label();
 
    //get the offset of a method inside an object of this type (or its subtype). Useful for dispatch.
    int get_method_offset(Symbol type, Symbol name);
    //get the offset of an attr. Since attrs are invisible outside of its own object, no need to provide type.
    int get_attr_offset(Symbol name);
+   //the offsets, or NULL if there is no such attribute or method (in this class).
+   int* find_attr_offset(Symbol name) { return attr_offset->lookup(name); }
+   int* find_method_offset(Symbol name) { return method_offset->lookup(name); }
+   //the method name defined in this class, or NULL.
+   method_class* find_method(Symbol name);
+   //true if a class below this one defines name again.
+   bool overridden_below(Symbol name);
 
    //get the closest ancestor of type in options. return NULL if no ancestor of type is contained in the list.
    int get_closest_ancestor(Symbol type, Cases cases);
@@ -117,7 +206,13 @@ public:
    int size_in_word();
 
    void code_initializer(ostream& s);
+   void code_method(method_class* method, ostream& s);
    void code_methods(ostream& s);
+
+   //the clone of the inherited method name coded for this class, or NULL.
+   method_class* find_clone(Symbol name);
+   void add_clone(method_class* method, uint64_t print);
+   uint64_t get_clones_print() { return clones_print; }
 };
 
 class BoolConst 
@@ -130,3 +225,6 @@ class BoolConst
   void code_ref(ostream&) const;
 };
 
+//Interns the predefined symbols and builds the basic classes; cgen()
+//calls it, a process that compiles many programs calls it up front.
+void cgen_prepare();
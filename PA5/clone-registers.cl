@@ -0,0 +1,36 @@
+-- run:
+-- run: COOL_REGISTER_ARGS=3 COOL_SPECULATE=1
+-- run: COOL_REGISTER_ARGS=3 COOL_CUSTOMIZE=1000
+-- run: COOL_REGISTER_ARGS=3 COOL_SPECULATE=1 COOL_CUSTOMIZE=1000
+-- run: COOL_REGISTER_ARGS=2 COOL_SPECULATE=1 COOL_CUSTOMIZE=1000
+-- Arguments in registers to a method of five arguments that is called
+-- through a guess of the receiver's class and on self from clones.
+class Shape {
+	k : Int <- 1;
+	mix(a : Int, b : Int, c : Int, d : Int, e : Int) : Int { a + b * c - d + e * k };
+	run(n : Int, acc : Int) : Int {
+		if n = 0 then acc else run(n - 1, acc + mix(n, 2, 3, 4, 5)) fi
+	};
+	scale(x : Int) : Int { mix(x, x, 1, 0, mix(1, 2, 3, 4, x)) };
+};
+class Square inherits Shape {
+	mix(a : Int, b : Int, c : Int, d : Int, e : Int) : Int { a * b + c + d + e };
+};
+class Circle inherits Shape {
+	mix(a : Int, b : Int, c : Int, d : Int, e : Int) : Int { a - b + c * d - e };
+};
+class Main inherits IO {
+	main() : Object {
+		let i : Int <- 0, total : Int <- 0, s : Shape in {
+			while i < 50 loop {
+				if i - (i / 10) * 10 = 0 then s <- new Circle else s <- new Square fi;
+				total <- total + s.mix(i, 1, 2, 3, 4) + s.run(3, i) + s.scale(i);
+				i <- i + 1;
+			} pool;
+			out_int(total);
+			out_string("\n");
+			out_int(new Shape.run(4, 0) + new Circle.scale(2) + new Square.scale(2));
+			out_string("\n");
+		}
+	};
+};
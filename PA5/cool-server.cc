@@ -0,0 +1,484 @@
+//
+// See copyright.h for copyright notice and limitation of liability
+// and disclaimer of warranty provisions.
+//
+#include "copyright.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  cool-server.cc
+//
+//  A compile server: a long-lived process that compiles COOL programs
+//  on request, so that a small compile does not pay for starting four
+//  phases and building their tables from scratch.
+//
+//    cool-server [cgen flags] SOCKET
+//        serves on the Unix socket SOCKET, which only its user can
+//        connect to.
+//    cool-server -connect SOCKET [-o file.s] file.cl ...
+//        compiles through the server; the messages of the phases go to
+//        stderr and the exit status is that of the compilation.
+//
+//  The server keeps the binary AST (../common/ast-binary.h) of every file
+//  it has parsed, keyed by a hash of the file's name and contents, and
+//  runs the lexer and the parser only on files it has not seen.  It
+//  builds the basic classes of the code generator once (cgen_prepare)
+//  and forks a child for each compilation, which merges the classes of
+//  the files into one program, runs it through semant and generates code
+//  from the warm tables; whatever the child changes dies with it.
+//
+//  The semantic analyzer is built on its own tree classes (PA4), so it
+//  stays a process of its own, started for each compilation.
+//
+//  Protocol: the client sends lines "cwd <dir>", "file <path>" and
+//  "output <path>", with the paths as the user gave them, and shuts down
+//  its side; the server answers with the messages of the compilation, a
+//  NUL byte and the exit status in decimal.  The server serves each
+//  request in dir, so the file names in the code and in the messages are
+//  those the phases would see run by hand.  A request that does not
+//  arrive whole within 10 seconds is refused as malformed.
+//
+//  The phases are those next to cool-server, or COOL_LEXER, COOL_PARSER
+//  and COOL_SEMANT.  COOL_SERVER_CACHE_MB bounds the AST cache (256 MB by
+//  default); when it is full it is emptied.
+//
+//  Link as cgen, with this file in place of cgen-phase.cc.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "cool-tree.h"
+#include "cgen.h"
+#include "../common/ast-binary.h"
+#include "../common/fingerprint.h"
+
+extern Program ast_root;      // root of the abstract syntax tree
+extern int optind;            // used for option processing (man 3 getopt for more info)
+
+int cool_yydebug;     // not used, but needed to link with handle_flags
+char *curr_filename;
+
+void handle_flags(int argc, char *argv[]);
+
+static std::string lexer, parser, semant;
+
+#define REQUEST_SECONDS        10          //to send a whole request
+
+//
+// I/O helpers
+//
+
+static bool write_all(int fd, const char* p, size_t n) {
+	while(n > 0) {
+		ssize_t k = write(fd, p, n);
+		if(k < 0 && errno == EINTR) continue;
+		if(k <= 0) return false;
+		p += k;
+		n -= k;
+	}
+	return true;
+}
+
+//false if reading fails (or times out) before the end.
+static bool read_all(int fd, std::string& out) {
+	char buf[64 * 1024];
+	ssize_t k;
+	while((k = read(fd, buf, sizeof(buf))) != 0) {
+		if(k < 0) {
+			if(errno == EINTR) continue;
+			return false;
+		}
+		out.append(buf, k);
+	}
+	return true;
+}
+
+//Reads fd to the end into words; false if it is not a whole number of them.
+static bool read_words(int fd, std::vector<uint32_t>& out) {
+	std::string bytes;
+	read_all(fd, bytes);
+	if(bytes.empty() || bytes.size() % sizeof(uint32_t) != 0) return false;
+	out.resize(bytes.size() / sizeof(uint32_t));
+	memcpy(out.data(), bytes.data(), bytes.size());
+	return true;
+}
+
+//path, from the current directory if it is relative.
+static std::string absolute(const char* path) {
+	if(path[0] == '/') return path;
+	char cwd[4096];
+	if(getcwd(cwd, sizeof(cwd)) == NULL) return path;
+	return std::string(cwd) + "/" + path;
+}
+
+static void message(int conn, const std::string& text) {
+	std::string line = "cool-server: " + text + "\n";
+	write_all(conn, line.data(), line.size());
+}
+
+static void reply(int conn, int status) {
+	char buf[32];
+	int n = snprintf(buf, sizeof(buf), "%c%d\n", 0, status);
+	write_all(conn, buf, n);
+}
+
+//Runs a phase, with arg (if not NULL) for its argument and stdin, stdout
+//and stderr on in, out and err.
+static pid_t start_phase(const std::string& exe, const char* arg, int in, int out, int err) {
+	pid_t pid = fork();
+	if(pid != 0) return pid;
+	dup2(in, 0);
+	dup2(out, 1);
+	dup2(err, 2);
+	setenv("COOL_PACKED_TOKENS", "1", 1);
+	setenv("COOL_BINARY_AST", "1", 1);
+	execl(exe.c_str(), exe.c_str(), arg, (char*) NULL);
+	fprintf(stderr, "cool-server: cannot run %s\n", exe.c_str());
+	_exit(127);
+}
+
+static bool succeeded(pid_t pid) {
+	int status;
+	if(pid < 0) return false;
+	while(waitpid(pid, &status, 0) < 0)
+		if(errno != EINTR) return false;
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// The AST cache
+//
+//////////////////////////////////////////////////////////////////////
+
+struct ParsedFile {
+	std::string path;		//absolute
+	std::string name;		//as the user gave it
+	size_t size;
+	std::vector<uint32_t> image;	//binary AST of the file alone
+};
+
+static std::map<uint64_t, ParsedFile> parsed_files;
+static size_t cached_words = 0;
+static size_t cache_limit_words;
+
+//The AST of the file name, from the cache or from lexer | parser;
+//NULL, with the messages sent to conn, if it does not parse.  The AST
+//holds name, so a file is cached by its absolute path and its name.
+static const std::vector<uint32_t>* parse_file(const std::string& name, int conn) {
+	int fd = open(name.c_str(), O_RDONLY | O_CLOEXEC);
+	if(fd < 0) {
+		message(conn, "cannot open " + name);
+		return NULL;
+	}
+	std::string text;
+	read_all(fd, text);
+	close(fd);
+
+	std::string path = absolute(name.c_str());
+	uint64_t key = fingerprint(path.c_str(), path.size() + 1);
+	key = fingerprint(name.c_str(), name.size() + 1, key);
+	key = fingerprint(text.data(), text.size(), key);
+	std::map<uint64_t, ParsedFile>::iterator it = parsed_files.find(key);
+	if(it != parsed_files.end() && it->second.path == path && it->second.name == name
+			&& it->second.size == text.size())
+		return &it->second.image;
+
+	int tokens[2], ast[2];
+	if(pipe2(tokens, O_CLOEXEC) < 0) {
+		message(conn, "out of pipes");
+		return NULL;
+	}
+	if(pipe2(ast, O_CLOEXEC) < 0) {
+		close(tokens[0]);
+		close(tokens[1]);
+		message(conn, "out of pipes");
+		return NULL;
+	}
+	pid_t lex = start_phase(lexer, name.c_str(), 0, tokens[1], conn);
+	pid_t parse = start_phase(parser, name.c_str(), tokens[0], ast[1], conn);
+	close(tokens[0]);
+	close(tokens[1]);
+	close(ast[1]);
+	std::vector<uint32_t> image;
+	bool whole = read_words(ast[0], image);
+	close(ast[0]);
+	bool ok = succeeded(lex) & succeeded(parse);	//wait for both
+	if(!ok || !whole)
+		return NULL;
+
+	ParsedFile& slot = parsed_files[key];	//replaces a file with the same hash
+	cached_words += image.size() - slot.image.size();
+	slot.path = path;
+	slot.name = name;
+	slot.size = text.size();
+	slot.image.swap(image);
+	return &slot.image;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Compiling
+//
+//////////////////////////////////////////////////////////////////////
+
+struct Request {
+	std::string cwd;
+	std::vector<std::string> files;
+	std::string output;
+};
+
+static bool read_request(int conn, Request& req) {
+	std::string text;
+	if(!read_all(conn, text))
+		return false;
+	std::istringstream in(text);
+	std::string line;
+	while(std::getline(in, line)) {
+		if(line.compare(0, 4, "cwd ") == 0)
+			req.cwd = line.substr(4);
+		else if(line.compare(0, 5, "file ") == 0)
+			req.files.push_back(line.substr(5));
+		else if(line.compare(0, 7, "output ") == 0)
+			req.output = line.substr(7);
+		else
+			return false;
+	}
+	return !req.cwd.empty() && !req.files.empty() && !req.output.empty();
+}
+
+//Runs in a child of the server: merges the files into one program, has
+//semant check it and writes the code.  Exits with the status of the
+//compilation.
+static void compile(const std::vector<const std::vector<uint32_t>*>& images,
+		const std::string& output, int conn) {
+	dup2(conn, 2);
+	Classes classes = nil_Classes();
+	for(size_t i = 0; i < images.size(); i++) {
+		program_class* p = dynamic_cast<program_class*>(read_binary_ast(*images[i]));
+		classes = append_Classes(classes, p->classes);
+	}
+	std::ostringstream merged;
+	write_binary_ast(program(classes), merged);
+	std::string bytes = merged.str();
+
+	int in[2], out[2];
+	if(pipe2(in, O_CLOEXEC) < 0 || pipe2(out, O_CLOEXEC) < 0) {
+		cerr << "cool-server: out of pipes" << endl;
+		exit(1);
+	}
+	pid_t pid = start_phase(semant, NULL, in[0], out[1], conn);
+	close(in[0]);
+	close(out[1]);
+	//semant reads all of its input before it writes anything
+	write_all(in[1], bytes.data(), bytes.size());
+	close(in[1]);
+	std::vector<uint32_t> typed;
+	bool whole = read_words(out[0], typed);
+	if(!succeeded(pid) || !whole)
+		exit(1);
+	ast_root = read_binary_ast(typed);
+
+	ofstream s(output.c_str());
+	if (!s) {
+		cerr << "Cannot open output file " << output << endl;
+		exit(1);
+	}
+	ast_root->cgen(s);
+	s.close();
+	exit(s ? 0 : 1);
+}
+
+static void serve(int conn) {
+	Request req;
+	if(!read_request(conn, req)) {
+		message(conn, "malformed request");
+		reply(conn, 1);
+		return;
+	}
+	if(chdir(req.cwd.c_str()) < 0) {
+		message(conn, "cannot change to " + req.cwd);
+		reply(conn, 1);
+		return;
+	}
+	if(cached_words > cache_limit_words) {
+		parsed_files.clear();
+		cached_words = 0;
+	}
+	std::vector<const std::vector<uint32_t>*> images;
+	bool ok = true;
+	for(size_t i = 0; i < req.files.size(); i++) {
+		const std::vector<uint32_t>* image = parse_file(req.files[i], conn);
+		if(image == NULL) ok = false;
+		images.push_back(image);
+	}
+	if(!ok) {
+		reply(conn, 1);
+		return;
+	}
+
+	//The child answers; the server goes back to accept.  The child forks
+	//again so that it can report a compilation that crashes.
+	pid_t child = fork();
+	if(child < 0) {
+		message(conn, "cannot fork");
+		reply(conn, 1);
+		return;
+	}
+	if(child > 0) return;
+	pid_t worker = fork();
+	if(worker == 0)
+		compile(images, req.output, conn);
+	int status = 1;
+	if(worker > 0) {
+		while(waitpid(worker, &status, 0) < 0 && errno == EINTR)
+			;
+		status = WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+	}
+	reply(conn, status);
+	_exit(0);
+}
+
+//true if the peer of conn runs as the user of the server.
+static bool same_user(int conn) {
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+	return getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0 && cred.uid == getuid();
+}
+
+static int server(const char* path, const char* self) {
+	//absolute, as each request is served in a directory of its own
+	std::string dir = absolute(self);
+	dir = dir.substr(0, dir.rfind('/'));
+	const char* v;
+	lexer = (v = getenv("COOL_LEXER")) ? absolute(v) : dir + "/lexer";
+	parser = (v = getenv("COOL_PARSER")) ? absolute(v) : dir + "/parser";
+	semant = (v = getenv("COOL_SEMANT")) ? absolute(v) : dir + "/semant";
+	v = getenv("COOL_SERVER_CACHE_MB");
+	cache_limit_words = (size_t) (v ? atoi(v) : 256) * 1024 * 1024 / sizeof(uint32_t);
+
+	int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if(listener < 0 || strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "cool-server: cannot use socket %s\n", path);
+		return 1;
+	}
+	strcpy(addr.sun_path, path);
+	unlink(path);
+	mode_t mask = umask(0177);		//the socket is made 0600
+	bool bound = bind(listener, (struct sockaddr*) &addr, sizeof(addr)) == 0;
+	umask(mask);
+	if(!bound || listen(listener, 64) < 0) {
+		perror("cool-server");
+		return 1;
+	}
+	signal(SIGPIPE, SIG_IGN);
+	cgen_prepare();
+
+	for(;;) {
+		while(waitpid(-1, NULL, WNOHANG) > 0)
+			;
+		int conn = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+		if(conn < 0) {
+			if(errno == EINTR || errno == ECONNABORTED) continue;
+			perror("cool-server");
+			return 1;
+		}
+		//a client that stalls must not hold up the others
+		struct timeval timeout = { REQUEST_SECONDS, 0 };
+		setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		if(same_user(conn))
+			serve(conn);
+		else {
+			message(conn, "refused: not the user of the server");
+			reply(conn, 1);
+		}
+		close(conn);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// The client
+//
+//////////////////////////////////////////////////////////////////////
+
+static int client(int argc, char* argv[]) {
+	if(argc < 2) {
+		fprintf(stderr, "usage: cool-server -connect SOCKET [-o file.s] file.cl ...\n");
+		return 1;
+	}
+	const char* path = argv[0];
+	char cwd[4096];
+	if(getcwd(cwd, sizeof(cwd)) == NULL) {
+		perror("cool-server");
+		return 1;
+	}
+	std::string request, output;
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else
+			request += "file " + std::string(argv[i]) + "\n";
+	}
+	if(output.empty()) {	// as cgen: the first file with .s for its extension
+		std::string first = request.substr(5, request.find('\n') - 5);
+		size_t dot = first.rfind('.'), slash = first.rfind('/');
+		if(dot != std::string::npos && (slash == std::string::npos || dot > slash)) first.erase(dot);
+		output = first + ".s";
+	}
+	request = "cwd " + std::string(cwd) + "\n" + request + "output " + output + "\n";
+
+	signal(SIGPIPE, SIG_IGN);	//a server that refuses closes early
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	if(fd < 0 || connect(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+		fprintf(stderr, "cool-server: cannot connect to %s\n", path);
+		return 1;
+	}
+	write_all(fd, request.data(), request.size());
+	shutdown(fd, SHUT_WR);
+	std::string answer;
+	read_all(fd, answer);
+	size_t end = answer.rfind('\0');
+	if(end == std::string::npos) {
+		fwrite(answer.data(), 1, answer.size(), stderr);
+		fprintf(stderr, "cool-server: no answer from the server\n");
+		return 1;
+	}
+	fwrite(answer.data(), 1, end, stderr);
+	return atoi(answer.c_str() + end + 1);
+}
+
+int main(int argc, char *argv[]) {
+	if(argc > 1 && strcmp(argv[1], "-connect") == 0)
+		return client(argc - 2, argv + 2);
+	handle_flags(argc, argv);
+	if(optind != argc - 1) {
+		fprintf(stderr, "usage: cool-server [cgen flags] SOCKET\n");
+		return 1;
+	}
+	return server(argv[optind], argv[0]);
+}
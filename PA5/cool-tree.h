@@ -11,6 +11,9 @@
 
 #include "tree.h"
 #include "cool-tree.handcode.h"
+#include "../common/arena.h"
+
+class AstWriter;		// ../common/ast-binary.h
 
 enum Feature_type {
 	FEATURE_ATTR,
@@ -18,14 +21,18 @@ enum Feature_type {
 };
 
 
+// Nodes of every phylum are allocated in compile_arena (see arena.h).
+
 // define the class for phylum
 // define simple phylum - Program
 typedef class Program_class *Program;
 
 class Program_class : public tree_node {
 public:
+   ARENA_ALLOCATED
    tree_node *copy()		 { return copy_Program(); }
    virtual Program copy_Program() = 0;
+   virtual void write_binary(AstWriter& w) = 0;
 
 #ifdef Program_EXTRAS
    Program_EXTRAS
@@ -38,8 +45,10 @@ typedef class Class__class *Class_;
 
 class Class__class : public tree_node {
 public:
+   ARENA_ALLOCATED
    tree_node *copy()		 { return copy_Class_(); }
    virtual Class_ copy_Class_() = 0;
+   virtual void write_binary(AstWriter& w) = 0;
 
 #ifdef Class__EXTRAS
    Class__EXTRAS
@@ -52,8 +61,10 @@ typedef class Feature_class *Feature;
 
 class Feature_class : public tree_node {
 public:
+   ARENA_ALLOCATED
    tree_node *copy()		 { return copy_Feature(); }
    virtual Feature copy_Feature() = 0;
+   virtual void write_binary(AstWriter& w) = 0;
    virtual Feature_type get_feature_type() = 0;
 
 #ifdef Feature_EXTRAS
@@ -67,8 +78,10 @@ typedef class Formal_class *Formal;
 
 class Formal_class : public tree_node {
 public:
+   ARENA_ALLOCATED
    tree_node *copy()		 { return copy_Formal(); }
    virtual Formal copy_Formal() = 0;
+   virtual void write_binary(AstWriter& w) = 0;
 
 #ifdef Formal_EXTRAS
    Formal_EXTRAS
@@ -81,9 +94,10 @@ typedef class Expression_class *Expression;
 
 class Expression_class : public tree_node {
 public:
+   ARENA_ALLOCATED
    tree_node *copy()		 { return copy_Expression(); }
    virtual Expression copy_Expression() = 0;
-   static int i_label;
+   virtual void write_binary(AstWriter& w) = 0;
 
 #ifdef Expression_EXTRAS
    Expression_EXTRAS
@@ -96,8 +110,10 @@ typedef class Case_class *Case;
 
 class Case_class : public tree_node {
 public:
+   ARENA_ALLOCATED
    tree_node *copy()		 { return copy_Case(); }
    virtual Case copy_Case() = 0;
+   virtual void write_binary(AstWriter& w) = 0;
 
 #ifdef Case_EXTRAS
    Case_EXTRAS
@@ -142,6 +158,7 @@ public:
    }
    Program copy_Program();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Program_SHARED_EXTRAS
    Program_SHARED_EXTRAS
@@ -168,6 +185,7 @@ public:
    }
    Class_ copy_Class_();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Class__SHARED_EXTRAS
    Class__SHARED_EXTRAS
@@ -194,6 +212,7 @@ public:
    }
    Feature copy_Feature();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
    Feature_type get_feature_type() { return FEATURE_METHOD; }
 
 #ifdef Feature_SHARED_EXTRAS
@@ -219,6 +238,7 @@ public:
    }
    Feature copy_Feature();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
    Feature_type get_feature_type() { return FEATURE_ATTR; }
 
 
@@ -243,6 +263,7 @@ public:
    }
    Formal copy_Formal();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Formal_SHARED_EXTRAS
    Formal_SHARED_EXTRAS
@@ -267,6 +288,7 @@ public:
    }
    Case copy_Case();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Case_SHARED_EXTRAS
    Case_SHARED_EXTRAS
@@ -289,6 +311,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -315,6 +338,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -339,6 +363,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -363,6 +388,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -385,6 +411,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -400,7 +427,6 @@ class typcase_class : public Expression_class {
 public:
    Expression expr;
    Cases cases;
-   static int case_layer;
 public:
    typcase_class(Expression a1, Cases a2) {
       expr = a1;
@@ -408,6 +434,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -428,6 +455,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -445,7 +473,6 @@ public:
    Symbol type_decl;
    Expression init;
    Expression body;
-   static int let_layer;
 public:
    let_class(Symbol a1, Symbol a2, Expression a3, Expression a4) {
       identifier = a1;
@@ -455,6 +482,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -477,6 +505,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -499,6 +528,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -521,6 +551,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -543,6 +574,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -563,6 +595,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -585,6 +618,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -607,6 +641,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -629,6 +664,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -649,6 +685,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -669,6 +706,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -689,6 +727,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -709,6 +748,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -729,6 +769,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -749,6 +790,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -767,6 +809,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -787,6 +830,7 @@ public:
    }
    Expression copy_Expression();
    void dump(ostream& stream, int n);
+   void write_binary(AstWriter& w);
 
 #ifdef Expression_SHARED_EXTRAS
    Expression_SHARED_EXTRAS
@@ -22,6 +22,8 @@ void assert_Symbol(Symbol b);
 Symbol copy_Symbol(Symbol b);
 
 class CgenNode;
+struct NonVoid;
+struct FrameUse;
 
 class Program_class;
 typedef Program_class *Program;
@@ -99,12 +101,18 @@ void dump_with_types(ostream& ,int);
 Symbol type;                                 \
 Symbol get_type() { return type; }           \
 Expression set_type(Symbol s) { type = s; return this; } \
+bool check_void;	/* of a dispatch or case: false if its value cannot be void */ \
+bool tail;	/* of a dispatch: true if it is the last thing its method does */ \
+virtual bool nonvoid(NonVoid& known) = 0; \
+virtual void frame_use(FrameUse& use) = 0; \
 virtual void code(ostream& s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env) = 0; \
 virtual void dump_with_types(ostream&,int) = 0;  \
 void dump_type(ostream&, int);               \
-Expression_class() { type = (Symbol) NULL; }
+Expression_class() { type = (Symbol) NULL; check_void = true; tail = false; }
 
 #define Expression_SHARED_EXTRAS           \
+bool nonvoid(NonVoid& known);                \
+void frame_use(FrameUse& use);               \
 void code(ostream& s, CgenNode* current_node, SymbolTable<Symbol, int>* frame_env); 			   \
 void dump_with_types(ostream&,int); 
 
@@ -0,0 +1,51 @@
+-- run:
+-- run: COOL_CUSTOMIZE=1
+-- run: COOL_CUSTOMIZE=1000
+-- A four-class hierarchy whose inherited methods dispatch on self and
+-- make new SELF_TYPE objects, called on each class and through static
+-- dispatch.
+class A inherits IO {
+	v : Int <- 1;
+	val() : Int { v };
+	step() : Int { 1 };
+	twice() : Int { val() + val() };
+	run(n : Int, acc : Int) : Int { if n = 0 then acc else run(n - 1, acc + step() + twice()) fi };
+	clone_me() : A { new SELF_TYPE };
+	who() : String { "A" };
+	tell() : Object { out_string(who()) };
+	up(x : A) : Int { x.step() + step() };
+};
+class B inherits A {
+	v2 : Int <- 5;
+	step() : Int { 2 };
+	who() : String { "B" };
+};
+class C inherits B {
+	val() : Int { 10 };
+	who() : String { "C" };
+};
+class D inherits C {
+};
+class Main inherits IO {
+	main() : Object {
+		let a : A <- new A, b : A <- new B, c : A <- new C, d : D <- new D in {
+			out_int(a.run(50, 0));
+			out_string(" ");
+			out_int(b.run(50, 0));
+			out_string(" ");
+			out_int(c.run(50, 0));
+			out_string(" ");
+			out_int(d.run(50, 0));
+			out_string(" ");
+			a.clone_me().tell();
+			b.clone_me().tell();
+			c.clone_me().tell();
+			d.clone_me().tell();
+			out_int(d@A.twice());
+			out_int(d@B.run(3, 0));
+			out_int(c@A.up(b));
+			out_int(d.up(a));
+			out_string("\n");
+		}
+	};
+};
@@ -67,6 +67,8 @@
 #define ZERO "$zero"		// Zero register 
 #define ACC  "$a0"		// Accumulator 
 #define A1   "$a1"		// For arguments to prim funcs 
+#define A2   "$a2"		// Register arguments (COOL_REGISTER_ARGS) 
+#define A3   "$a3"		// with $a1 
 #define SELF "$s0"		// Ptr to self (callee saves) 
 #define T1   "$t1"		// Temporary 1 
 #define T2   "$t2"		// Temporary 2 
@@ -81,6 +83,7 @@
 //
 #define JALR  "\tjalr\t"  
 #define JAL   "\tjal\t"                 
+#define JR    "\tjr\t"
 #define RET   "\tjr\t"RA"\t"
 
 #define SW    "\tsw\t"
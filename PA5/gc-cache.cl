@@ -0,0 +1,25 @@
+-- cached
+-- run:
+-- run: -g
+-- run: -g -t
+-- The code of a class is kept for the collector it was compiled for: the
+-- frames of a program compiled with -g are cleared for the collector, so
+-- the code cached without -g is not reused.
+class List {
+	head : Int;
+	tail : List;
+	cons(h : Int, t : List) : List { { head <- h; tail <- t; self; } };
+	sum() : Int { if isvoid tail then head else head + tail.sum() fi };
+};
+class Main inherits IO {
+	build(n : Int, l : List) : List {
+		if n = 0 then l else build(n - 1, new List.cons(n, l)) fi
+	};
+	main() : Object {
+		let l : List <- build(200, new List.cons(0, new List)) in {
+			out_int(l.sum());
+			out_string("\n");
+			out_string("cached".concat(" ").concat("code\n"));
+		}
+	};
+};
@@ -0,0 +1,41 @@
+-- run:
+-- run: COOL_IMPLICIT_VOID_CHECKS=1
+-- Receivers that cannot be void: new objects, self, literals, let and
+-- case variables bound to them, and variables assigned from those.
+class A {
+	n : Int <- 0;
+	a : A;
+	inc() : A { { n <- n + 1; self; } };
+	get() : Int { n };
+	geta() : A { a };
+};
+class Main inherits IO {
+	main() : Object {
+		let y : A <- new A, z : A, i : Int <- 0 in {
+			y.inc();
+			y.inc().inc();
+			out_int(y.get());
+			out_string("\n");
+			z <- y;
+			out_int(z.get());
+			out_string("\n");
+			while i < 3 loop {
+				z.inc();
+				if i = 1 then z <- y.geta() else z <- y fi;
+				i <- i + 1;
+				if isvoid z then z <- new A else z fi;
+				z.inc();
+			} pool;
+			out_int(z.get());
+			out_string("\n");
+			let y : A in if isvoid y then out_string("void\n") else y.inc() fi;
+			case y of q : A => q.inc(); o : Object => o; esac;
+			out_int(y.get());
+			out_string("\n");
+			out_int("hello".length());
+			out_int((1 + 2).copy());
+			out_int(new A.inc().get());
+			out_string("\n");
+		}
+	};
+};
@@ -0,0 +1,46 @@
+-- run:
+-- run: COOL_REGISTER_ARGS=1
+-- run: COOL_REGISTER_ARGS=3
+-- Arguments passed in registers: leaf methods, methods that call, tail
+-- calls with more arguments than registers, assignments to arguments,
+-- overrides of runtime methods, and calls nested in arguments.
+class A inherits IO {
+	k : Int <- 3;
+	add3(a : Int, b : Int, c : Int) : Int { a + b + c };
+	leaf(a : Int, b : Int, c : Int, d : Int) : Int { if a < b then c else d fi };
+	asg(a : Int, b : Int) : Int { { a <- a + b; b <- a; a; } };
+	sum(n : Int, acc : Int) : Int { if n = 0 then acc else sum(n - 1, acc + n) fi };
+	cnt(n : Int, a : Int, b : Int, c : Int, d : Int, e : Int) : Int {
+		if n = 0 then a + b + c + d + e else cnt(n - 1, b, c, d, e, a + 1) fi
+	};
+	pick(a : Int, b : Int, c : Int) : Int { c };
+	mix(x : Int, y : Int) : Int { add3(pick(x, y, 1), y, add3(x, x, k)) };
+	str(s : String, t : String) : String { s.concat(t) };
+	me(a : A, b : Int) : A { a };
+};
+class B inherits A {
+	add3(a : Int, b : Int, c : Int) : Int { a * b * c };
+	out_string(s : String) : SELF_TYPE { { (new IO).out_string("<"); (new IO).out_string(s); self; } };
+};
+class Main inherits IO {
+	sh(i : Int) : Object { { out_int(i); out_string(" "); } };
+	main() : Object {
+		let a : A <- new A, b : A <- new B in {
+			sh(a.add3(1, 2, 3));
+			sh(b.add3(2, 3, 4));
+			sh(b@A.add3(2, 3, 4));
+			sh(a.leaf(1, 2, 30, 40));
+			sh(a.leaf(3, 2, 30, 40));
+			sh(a.asg(5, 6));
+			sh(a.sum(1000, 0));
+			sh(a.cnt(101, 1, 2, 3, 4, 5));
+			sh(a.mix(10, 20));
+			sh(b.mix(10, 20));
+			out_string(a.str("ab", "cd"));
+			b.out_string("x\n");
+			sh(a.me(b, 1).add3(a.add3(1, 1, 1), b.add3(2, 2, 2), a.me(a, 2).add3(1, b.add3(1, 2, 3), 1)));
+			sh(a.add3(a.add3(1, 2, 3), a.leaf(1, 2, 3, 4), new A.add3(7, 8, 9)));
+			out_string("\n");
+		}
+	};
+};
@@ -0,0 +1,125 @@
+#!/bin/bash
+#
+#  run-tests.sh
+#              Compiles the test programs of this directory and runs them
+#              in SPIM, comparing what they print with what they should.
+#
+#  A test is a program X.cl next to its expected output X.out, which is
+#  what SPIM prints after loading the trap handler.  Lines of X.cl of the
+#  form
+#
+#      -- run: [VAR=value ...] [cgen flags]
+#
+#  ask for one run each, with X compiled by cgen under the variables and
+#  flags given; a test without such lines is run once as is.  Every run
+#  of X must print X.out.  No other COOL_ variable is passed to the
+#  phases.
+#
+#  The runs of a test with a line "-- cached" share, in order, a cgen
+#  cache (COOL_CGEN_CACHE, see cgen-cache.h) that starts empty, and the
+#  assembly of each must be the same as without the cache.
+#
+#  Output is one line per run, e.g.
+#
+#    ok    void-let.cl COOL_IMPLICIT_VOID_CHECKS=1
+#
+#  followed by a diff for each run that failed.
+#
+#  usage: run-tests.sh [X.cl ...]   (default: every X.cl with an X.out)
+#
+#  Environment: COOL_LEXER COOL_PARSER COOL_SEMANT COOL_CGEN as for
+#  ../bench/phase-bench.sh, SPIM the simulator (spim), and TEST_DIR where
+#  the assembly and output of the runs are kept.
+#
+
+top=$(cd "$(dirname "$0")/.." && pwd)
+
+LEXER=${COOL_LEXER:-$top/PA2/lexer}
+PARSER=${COOL_PARSER:-$top/PA3/parser}
+SEMANT=${COOL_SEMANT:-$top/PA4/semant}
+CGEN=${COOL_CGEN:-$top/PA5/cgen}
+SPIM=${SPIM:-spim}
+
+TEST_DIR=${TEST_DIR:-${TMPDIR:-/tmp}/cool-tests}
+
+for exe in "$LEXER" "$PARSER" "$SEMANT" "$CGEN"; do
+  if [ ! -x "$exe" ]; then
+    echo "run-tests: $exe is not built" >&2
+    exit 1
+  fi
+done
+
+unset $(env | sed -n 's/^\(COOL_[A-Za-z0-9_]*\)=.*/\1/p')
+
+# the file names in abort messages are the ones given to the phases
+cd "$top/PA5" || exit 1
+mkdir -p "$TEST_DIR"
+
+if [ $# = 0 ]; then
+  for out in *.out; do set -- "$@" "${out%.out}.cl"; done
+fi
+
+#
+# run test [VAR=value ...] [flags ...]
+#
+# Compiles test.cl from its typed AST with the variables and flags given
+# and leaves what SPIM printed in $TEST_DIR/test.got.  With $cache set
+# the program is also compiled with that cache.
+#
+run() {
+  local t=$1 w
+  local vars=() flags=()
+  shift
+  : > "$TEST_DIR/$t.got"
+  for w in "$@"; do
+    case $w in
+      *=*) vars+=("$w") ;;
+      *)   flags+=("$w") ;;
+    esac
+  done
+  env "${vars[@]}" "$CGEN" "${flags[@]}" -o "$TEST_DIR/$t.s" "$t.cl" \
+      < "$TEST_DIR/$t.typed" || return 1
+  if [ -n "$cache" ]; then
+    env "${vars[@]}" COOL_CGEN_CACHE="$cache" "$CGEN" "${flags[@]}" \
+        -o "$TEST_DIR/$t.cached.s" "$t.cl" < "$TEST_DIR/$t.typed" || return 1
+    if ! cmp -s "$TEST_DIR/$t.s" "$TEST_DIR/$t.cached.s"; then
+      echo "the code from the cache is not the same" > "$TEST_DIR/$t.got"
+      return 1
+    fi
+  fi
+  "$SPIM" -file "$TEST_DIR/$t.s" < /dev/null 2>&1 |
+    awk 'loaded { print } /^Loaded: / { loaded = 1 }' > "$TEST_DIR/$t.got"
+}
+
+runs=0 failed=0
+for cl in "$@"; do
+  t=${cl%.cl}
+  if [ ! -f "$t.out" ]; then
+    echo "run-tests: $t.cl has no $t.out" >&2
+    exit 1
+  fi
+  "$LEXER" "$t.cl" | "$PARSER" "$t.cl" | "$SEMANT" "$t.cl" > "$TEST_DIR/$t.typed" || {
+    echo "run-tests: $t.cl does not compile" >&2
+    exit 1
+  }
+  cache=
+  if grep -q '^-- cached$' "$t.cl"; then
+    cache=$TEST_DIR/$t.cache
+    rm -f "$cache"
+  fi
+  lines=$(sed -n 's/^-- run://p' "$t.cl")
+  [ -n "$lines" ] || lines=" "
+  while read -r args; do
+    runs=$((runs + 1))
+    if run "$t" $args && cmp -s "$t.out" "$TEST_DIR/$t.got"; then
+      echo "ok    $t.cl $args"
+    else
+      failed=$((failed + 1))
+      echo "FAIL  $t.cl $args"
+      diff "$t.out" "$TEST_DIR/$t.got" | head -20
+    fi
+  done <<< "$lines"
+done
+
+echo "$failed of $runs runs failed"
+[ $failed = 0 ]
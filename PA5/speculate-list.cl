@@ -0,0 +1,45 @@
+-- run:
+-- run: COOL_SPECULATE=1
+-- A list of shapes, nine in ten of them squares: the guess for the
+-- dispatches on the shapes is Square.
+class Shape {
+	side : Int;
+	init(s : Int) : SELF_TYPE { { side <- s; self; } };
+	area() : Int { 0 };
+	name() : String { "shape" };
+};
+class Square inherits Shape {
+	area() : Int { side * side };
+};
+class Circle inherits Shape {
+	area() : Int { 3 * side * side };
+	name() : String { "circle" };
+};
+class Node {
+	s : Shape;
+	next : Node;
+	mk(x : Shape, n : Node) : Node { { s <- x; next <- n; self; } };
+	shape() : Shape { s };
+	tail() : Node { next };
+};
+class Main inherits IO {
+	main() : Object {
+		let l : Node, i : Int <- 0, total : Int <- 0 in {
+			while i < 300 loop {
+				if i - (i / 10) * 10 = 0
+				then l <- new Node.mk(new Circle.init(i), l)
+				else l <- new Node.mk(new Square.init(i), l)
+				fi;
+				i <- i + 1;
+			} pool;
+			while not isvoid l loop {
+				total <- total + l.shape().area();
+				out_string(l.shape().name().substr(0, 1));
+				l <- l.tail();
+			} pool;
+			out_string("\n");
+			out_int(total);
+			out_string("\n");
+		}
+	};
+};
@@ -0,0 +1,33 @@
+-- run:
+-- run: COOL_SPECULATE=1
+-- Getters and setters called in a loop, on a class with a subclass: the
+-- guess is right for c and wrong for s.
+class Counter {
+	n : Int <- 0;
+	get() : Int { n };
+	set(v : Int) : SELF_TYPE { { n <- v; self; } };
+	inc() : Int { n <- n + 1 };
+	twice(a : Int, b : Int) : Int { a + b + n };
+};
+class Sub inherits Counter {
+	bump() : Int { inc() + get() };
+};
+class Main inherits IO {
+	c : Counter <- new Counter;
+	s : Sub <- new Sub;
+	main() : Object {
+		let i : Int <- 0 in {
+			while i < 100 loop {
+				c.set(c.get() + 1);
+				i <- i + 1 + (let t : Int <- c.twice(i, 2) in t - t);
+				s.bump();
+			} pool;
+			out_int(c.get());
+			out_string(" ");
+			out_int(s@Counter.get());
+			out_string(" ");
+			out_int(c.twice(3, let q : Int <- 4 in q + (let r : Int <- 5 in r)));
+			out_string("\n");
+		}
+	};
+};
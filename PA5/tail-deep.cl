@@ -0,0 +1,23 @@
+-- Calls in tail position do not grow the stack.  Kept, the frames of the
+-- 100000 deep recursion of f need more than the megabyte of stack SPIM
+-- gives a program.
+class A {
+	f(n : Int, acc : Int) : Int { if n = 0 then acc else f(n - 1, acc + n) fi };
+	g(n : Int) : Int { if n = 0 then 7 else h(n - 1, 1, 2, 3) fi };
+	h(n : Int, a : Int, b : Int, c : Int) : Int { if n = 0 then a + b + c else k(n - 1) fi };
+	k(n : Int) : Int { g(n) };
+};
+class Main inherits IO {
+	main() : Object {
+		let a : A <- new A in {
+			out_int(a.f(30000, 0));
+			out_string("\n");
+			out_int(a.f(100000, 0));
+			out_string("\n");
+			out_int(a.g(30001));
+			out_string("\n");
+			out_int(a.g(30000));
+			out_string("\n");
+		}
+	};
+};
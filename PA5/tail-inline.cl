@@ -0,0 +1,23 @@
+-- run:
+-- run: COOL_INLINE_BUDGET=0
+-- Calls in tail position to methods that are inlined, or that inline
+-- others.
+class A {
+	inc(x : Int) : Int { x + 1 };
+	twice(x : Int) : Int { let y : Int <- x + x in y };
+	t(a : Int) : Int { inc(a) };
+	u(a : Int) : Int { self@A.twice(a) };
+	v(a : Int) : Int { if a < 0 then 0 else twice(inc(a)) fi };
+};
+class Main inherits IO {
+	main() : Object {
+		let a : A <- new A in {
+			out_int(a.t(5));
+			out_string("\n");
+			out_int(a.u(5));
+			out_string("\n");
+			out_int(a.v(5));
+			out_string("\n");
+		}
+	};
+};
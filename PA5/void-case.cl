@@ -0,0 +1,17 @@
+-- run:
+-- run: COOL_IMPLICIT_VOID_CHECKS=1
+-- A case on a let variable that is void ends the program with the line
+-- of the case.
+class A {
+	f() : Int { 1 };
+};
+class Main inherits IO {
+	main() : Object {
+		let a : A, b : A <- new A in {
+			case b of x : A => out_int(x.f()); esac;
+			out_string("\n");
+			case a of x : A => out_int(x.f()); o : Object => 0; esac;
+			out_string("not reached\n");
+		}
+	};
+};
@@ -0,0 +1,23 @@
+-- run:
+-- run: COOL_IMPLICIT_VOID_CHECKS=1
+-- A dispatch on an attribute that is void ends the program with the line
+-- of the dispatch; with COOL_IMPLICIT_VOID_CHECKS it is the fault of the
+-- load of the receiver's dispatch table that does.
+class A {
+	x : A;
+	f() : Int { 1 };
+	g() : Int { x.f() };
+	set(a : A) : A { x <- a };
+};
+class Main inherits IO {
+	a : A <- new A;
+	main() : Object {
+		{
+			a.set(new A);
+			out_int(a.g());
+			out_string("\n");
+			out_int(new A.g());
+			out_string("not reached\n");
+		}
+	};
+};
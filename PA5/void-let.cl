@@ -0,0 +1,17 @@
+-- run:
+-- run: COOL_IMPLICIT_VOID_CHECKS=1
+-- A dispatch on a let variable that is void ends the program with the
+-- line of the dispatch.
+class A {
+	f() : Int { 1 };
+};
+class Main inherits IO {
+	main() : Object {
+		let a : A, b : A <- new A in {
+			out_int(b.f());
+			out_string("\n");
+			out_int(a.f());
+			out_string("not reached\n");
+		}
+	};
+};
@@ -0,0 +1,21 @@
+-- run: COOL_IMPLICIT_VOID_CHECKS=1
+-- With COOL_IMPLICIT_VOID_CHECKS set, a fault that is no void check, here
+-- the break of a division by zero, is reported by the exception handler
+-- and ends the program: "  Exception 9 occurred and halted the program".
+class A {
+	f() : Int { 1 };
+};
+class B inherits A {
+	f() : Int { 2 };
+};
+class Main inherits IO {
+	a : A <- new A;
+	main() : Object {
+		let zero : Int <- 0 in {
+			out_int(a.f());
+			out_string("\n");
+			out_int(1 / zero);
+			out_string("not reached\n");
+		}
+	};
+};
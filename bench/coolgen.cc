@@ -0,0 +1,319 @@
+//
+// coolgen.cc
+//
+// Deterministic generator of semantically valid COOL programs, used to feed
+// the phase benchmarks (phase-bench.sh) with inputs of a chosen shape:
+//
+//    -classes N    number of user classes                       (default 100)
+//    -depth D      length of every inheritance chain            (default 5)
+//    -block N      expressions in the block of every f method   (default 20)
+//    -strings N    string literals spread over all classes      (default 100)
+//    -cases N      branches of the case expression in each class (default 0)
+//    -seed S       seed of the pseudo random generator          (default 1)
+//    -o file       output file                                  (default stdout)
+//
+// The same arguments always produce the same program.  The shapes are the
+// ones that stress the compiler:
+//  - long chains make find_first_appearance_of_methods, get_closest_ancestor
+//    and ClassTable::lub walk the hierarchy over and over.  Every class of a
+//    chain overrides m(), so dispatch tables are rebuilt at every level.
+//  - conditionals whose branches are objects of different classes force a
+//    lub between classes of the same or of different chains.
+//  - case expressions with many branches over distinct classes.
+//  - big blocks and many distinct literals fill the AST lists and the
+//    string/int tables.
+//
+// Build: g++ -O2 -o coolgen coolgen.cc
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//splitmix64: small, fast and gives the same sequence on every platform.
+class Random {
+private:
+	uint64_t state;
+public:
+	Random(uint64_t seed) : state(seed) {}
+	uint64_t next() {
+		uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+	//uniform in [0, n)
+	int below(int n) { return n <= 0 ? 0 : (int) (next() % (uint64_t) n); }
+	bool chance(int percent) { return below(100) < percent; }
+};
+
+struct Options {
+	int classes;
+	int depth;
+	int block;
+	int strings;
+	int cases;
+	uint64_t seed;
+	const char* output;
+};
+
+class Generator {
+private:
+	Options opt;
+	Random rnd;
+	FILE* out;
+	int literal_count;		//string literals emitted so far
+	int let_count;			//fresh names for let variables
+
+	//index of the first class of the chain that class i belongs to
+	int chain_root(int i) { return i - i % opt.depth; }
+	//number of string literals class i has to emit
+	int strings_of(int i) {
+		return opt.strings / opt.classes + (i < opt.strings % opt.classes ? 1 : 0);
+	}
+
+	void emit(const std::string& s) { fputs(s.c_str(), out); }
+	std::string num(long n) { char buf[32]; snprintf(buf, sizeof(buf), "%ld", n); return buf; }
+	std::string cls(int i) { return "C" + num(i); }
+
+	std::string string_literal();
+	std::string int_expr(int cur, int depth, std::vector<std::string>& locals);
+	std::string bool_expr(int cur, int depth, std::vector<std::string>& locals);
+	std::string object_expr(int cur, int depth, std::vector<std::string>& locals);
+	std::string case_expr(int cur, int branches, std::vector<std::string>& locals);
+
+	void emit_class(int i);
+	void emit_main();
+public:
+	Generator(const Options& o, FILE* f) :
+		opt(o), rnd(o.seed), out(f), literal_count(0), let_count(0) {}
+	void run();
+};
+
+//A literal with a few escapes so that the escape rules of the scanner are used too.
+std::string Generator::string_literal() {
+	static const char* words[] = { "alpha", "beta", "gamma", "delta", "epsilon", "zeta",
+			"eta", "theta", "iota", "kappa", "lambda", "mu" };
+	std::string s = "\"";
+	int n = 1 + rnd.below(6);
+	for(int k = 0; k < n; ++k) {
+		s += words[rnd.below(12)];
+		s += rnd.chance(10) ? "\\t" : " ";
+	}
+	s += num(literal_count++);			//every literal is distinct
+	if(rnd.chance(20)) s += "\\n";
+	s += "\"";
+	return s;
+}
+
+//An expression of static type Int, using only names visible in class `cur'.
+std::string Generator::int_expr(int cur, int depth, std::vector<std::string>& locals) {
+	int root = chain_root(cur);
+	int choice = depth <= 0 ? rnd.below(3) : rnd.below(12);
+	switch(choice) {
+	case 0:
+		return num(rnd.below(1000));
+	case 1:
+		return locals[rnd.below(locals.size())];
+	case 2:
+		//attribute of this class or of an ancestor
+		return "a" + num(root + rnd.below(cur - root + 1));
+	case 3:
+		return "(" + int_expr(cur, depth - 1, locals) + " + " + int_expr(cur, depth - 1, locals) + ")";
+	case 4:
+		return "(" + int_expr(cur, depth - 1, locals) + " - " + int_expr(cur, depth - 1, locals) + ")";
+	case 5:
+		return "(" + int_expr(cur, depth - 1, locals) + " * " + int_expr(cur, depth - 1, locals) + ")";
+	case 6:
+		return "~" + int_expr(cur, depth - 1, locals);
+	case 7:
+		return "if " + bool_expr(cur, depth - 1, locals) + " then " + int_expr(cur, depth - 1, locals)
+				+ " else " + int_expr(cur, depth - 1, locals) + " fi";
+	case 8: {
+		std::string init = int_expr(cur, depth - 1, locals);
+		std::string name = "y" + num(let_count++);
+		locals.push_back(name);
+		std::string body = int_expr(cur, depth - 1, locals);
+		locals.pop_back();
+		return "(let " + name + " : Int <- " + init + " in " + body + ")";
+	}
+	case 9:
+		//dispatch to a method of a strict ancestor (never recursive)
+		if(cur > root)
+			return "f" + num(root + rnd.below(cur - root)) + "(" + int_expr(cur, depth - 1, locals) + ")";
+		return "self.m(" + int_expr(cur, depth - 1, locals) + ")";
+	case 10:
+		//dispatch on a fresh object, possibly of another chain
+		{
+			int j = rnd.below(opt.classes);
+			return "(new " + cls(j) + ").m(" + int_expr(cur, depth - 1, locals) + ")";
+		}
+	default:
+		return "{ " + int_expr(cur, depth - 1, locals) + "; " + int_expr(cur, depth - 1, locals) + "; }";
+	}
+}
+
+//An expression of static type Bool.
+std::string Generator::bool_expr(int cur, int depth, std::vector<std::string>& locals) {
+	switch(depth <= 0 ? rnd.below(2) : rnd.below(6)) {
+	case 0:
+		return rnd.chance(50) ? "true" : "false";
+	case 1:
+		return int_expr(cur, 0, locals) + " < " + int_expr(cur, 0, locals);
+	case 2:
+		return int_expr(cur, depth - 1, locals) + " <= " + int_expr(cur, depth - 1, locals);
+	case 3:
+		return int_expr(cur, depth - 1, locals) + " = " + int_expr(cur, depth - 1, locals);
+	case 4:
+		return "not " + bool_expr(cur, depth - 1, locals);
+	default:
+		return "isvoid " + object_expr(cur, depth - 1, locals);
+	}
+}
+
+//An expression whose static type is a user class.  Conditionals over objects
+//of two unrelated depths of the hierarchy make semant compute a lub.
+std::string Generator::object_expr(int cur, int depth, std::vector<std::string>& locals) {
+	switch(depth <= 0 ? rnd.below(2) : rnd.below(3)) {
+	case 0:
+		return "new " + cls(rnd.below(opt.classes));
+	case 1:
+		return "self";
+	default:
+		return "if " + bool_expr(cur, depth - 1, locals) + " then new " + cls(rnd.below(opt.classes))
+				+ " else new " + cls(rnd.below(opt.classes)) + " fi";
+	}
+}
+
+//A case expression over `branches' distinct classes.  The candidate types are
+//all user classes plus the basic ones; branches beyond that are dropped.
+std::string Generator::case_expr(int cur, int branches, std::vector<std::string>& locals) {
+	std::vector<std::string> types;
+	types.push_back("Object");
+	types.push_back("IO");
+	types.push_back("Int");
+	types.push_back("String");
+	types.push_back("Bool");
+	for(int j = 0; j < opt.classes; ++j)
+		types.push_back(cls(j));
+	//partial Fisher-Yates: the first `branches' entries become a random subset
+	if(branches > (int) types.size()) branches = types.size();
+	for(int k = 0; k < branches; ++k) {
+		int r = k + rnd.below(types.size() - k);
+		std::swap(types[k], types[r]);
+	}
+	std::string s = "case " + object_expr(cur, 1, locals) + " of\n";
+	for(int k = 0; k < branches; ++k) {
+		s += "\t\t\tb" + num(k) + " : " + types[k] + " => " + int_expr(cur, 1, locals) + ";\n";
+	}
+	return s + "\t\tesac";
+}
+
+void Generator::emit_class(int i) {
+	int root = chain_root(i);
+	std::vector<std::string> locals;
+	locals.push_back("x");
+
+	emit("class " + cls(i) + (i == root ? " inherits IO" : " inherits " + cls(i - 1)) + " {\n");
+	emit("\ta" + num(i) + " : Int <- " + num(rnd.below(100)) + ";\n");
+	emit("\ts" + num(i) + " : String;\n");
+	emit("\to" + num(i) + " : Object;\n");
+
+	//m is defined by the root of the chain and overridden at every level.
+	if(i == root)
+		emit("\tm(x : Int) : Int { x + a" + num(i) + " };\n");
+	else
+		emit("\tm(x : Int) : Int { self@" + cls(i - 1) + ".m(x) + a" + num(i) + " };\n");
+
+	//f: the big block
+	emit("\tf" + num(i) + "(x : Int) : Int { {\n");
+	for(int k = 0; k < opt.block; ++k) {
+		switch(rnd.below(4)) {
+		case 0:
+			emit("\t\tx <- " + int_expr(i, 3, locals) + ";\n");
+			break;
+		case 1:
+			emit("\t\to" + num(i) + " <- " + object_expr(i, 2, locals) + ";\n");
+			break;
+		case 2:
+			emit("\t\tif " + bool_expr(i, 2, locals) + " then x <- x + 1 else x <- x - 1 fi;\n");
+			break;
+		default:
+			emit("\t\t" + int_expr(i, 3, locals) + ";\n");
+			break;
+		}
+	}
+	emit("\t\tx;\n\t} };\n");
+
+	//g: this class's share of the string literals
+	int n = strings_of(i);
+	emit("\tg" + num(i) + "() : String { {\n");
+	for(int k = 0; k < n; ++k)
+		emit("\t\ts" + num(i) + " <- " + string_literal() + ";\n");
+	emit("\t\ts" + num(i) + ";\n\t} };\n");
+
+	if(opt.cases > 0)
+		emit("\tk" + num(i) + "(x : Int) : Int {\n\t\t" + case_expr(i, opt.cases, locals) + "\n\t};\n");
+
+	emit("};\n\n");
+}
+
+void Generator::emit_main() {
+	emit("class Main inherits IO {\n");
+	emit("\tmain() : Object { out_string(\"ok\\n\") };\n");
+	emit("};\n");
+}
+
+void Generator::run() {
+	emit("(* generated by coolgen -classes " + num(opt.classes) + " -depth " + num(opt.depth)
+			+ " -block " + num(opt.block) + " -strings " + num(opt.strings)
+			+ " -cases " + num(opt.cases) + " -seed " + num((long) opt.seed) + " *)\n\n");
+	for(int i = 0; i < opt.classes; ++i)
+		emit_class(i);
+	emit_main();
+}
+
+static void usage(const char* prog) {
+	fprintf(stderr, "usage: %s [-classes N] [-depth D] [-block N] [-strings N] "
+			"[-cases N] [-seed S] [-o file]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char** argv) {
+	Options opt;
+	opt.classes = 100;
+	opt.depth = 5;
+	opt.block = 20;
+	opt.strings = 100;
+	opt.cases = 0;
+	opt.seed = 1;
+	opt.output = NULL;
+
+	for(int i = 1; i < argc; ++i) {
+		if(i + 1 >= argc) usage(argv[0]);
+		const char* arg = argv[i];
+		const char* val = argv[++i];
+		if(!strcmp(arg, "-classes")) opt.classes = atoi(val);
+		else if(!strcmp(arg, "-depth")) opt.depth = atoi(val);
+		else if(!strcmp(arg, "-block")) opt.block = atoi(val);
+		else if(!strcmp(arg, "-strings")) opt.strings = atoi(val);
+		else if(!strcmp(arg, "-cases")) opt.cases = atoi(val);
+		else if(!strcmp(arg, "-seed")) opt.seed = strtoull(val, NULL, 10);
+		else if(!strcmp(arg, "-o")) opt.output = val;
+		else usage(argv[0]);
+	}
+	if(opt.classes < 1 || opt.depth < 1 || opt.block < 0 || opt.strings < 0 || opt.cases < 0)
+		usage(argv[0]);
+
+	FILE* out = opt.output ? fopen(opt.output, "w") : stdout;
+	if(out == NULL) {
+		fprintf(stderr, "coolgen: cannot open %s\n", opt.output);
+		return 1;
+	}
+	Generator(opt, out).run();
+	if(out != stdout) fclose(out);
+	return 0;
+}
@@ -0,0 +1,137 @@
+#!/bin/bash
+#
+#  incremental-bench.sh
+#              Edit-compile latency of semant and cgen with their caches
+#              (COOL_SEMANT_CACHE, see ../PA4/semant-cache.h, and
+#              COOL_CGEN_CACHE, see ../PA5/cgen-cache.h).
+#
+#  The input is a coolgen program of BENCH_CLASSES classes (2000 by
+#  default).  semant is timed on its AST and cgen on the typed AST, each
+#  in these modes:
+#
+#      full        no cache
+#      cold        with an empty cache, which it fills
+#      unchanged   the same program again
+#      body_edit   a literal in a method of one class changed: only that
+#                  class is checked again
+#      iface_edit  an attribute added to C0, the root of the first chain:
+#                  C0 and every class that looks at C0 or its descendants
+#                  are checked again
+#      line_shift  a comment line added at the top of the file: every
+#                  class moves down a line but none changes
+#
+#  Each edit starts from the cache of the unedited program.  Output is one
+#  JSON object per phase and mode on stdout, e.g.
+#
+#    {"phase":"cgen","mode":"body_edit","classes":2000,"seconds":0.081234}
+#
+#  Environment: COOL_LEXER COOL_PARSER COOL_SEMANT COOL_CGEN, BENCH_DIR,
+#  BENCH_REPEAT and BENCH_SEED as for phase-bench.sh, and BENCH_CLASSES.
+#
+
+top=$(cd "$(dirname "$0")/.." && pwd)
+
+LEXER=${COOL_LEXER:-$top/PA2/lexer}
+PARSER=${COOL_PARSER:-$top/PA3/parser}
+SEMANT=${COOL_SEMANT:-$top/PA4/semant}
+CGEN=${COOL_CGEN:-$top/PA5/cgen}
+
+BENCH_DIR=${BENCH_DIR:-${TMPDIR:-/tmp}/cool-incremental-bench}
+BENCH_REPEAT=${BENCH_REPEAT:-3}
+BENCH_SEED=${BENCH_SEED:-1}
+BENCH_CLASSES=${BENCH_CLASSES:-2000}
+
+COOLGEN=${COOLGEN:-$top/bench/coolgen}
+if [ ! -x "$COOLGEN" ]; then
+  ${CXX:-g++} -O2 -o "$COOLGEN" "$top/bench/coolgen.cc" || exit 1
+fi
+
+for exe in "$LEXER" "$PARSER" "$SEMANT" "$CGEN"; do
+  if [ ! -x "$exe" ]; then
+    echo "incremental-bench: $exe is not built" >&2
+    exit 1
+  fi
+done
+
+mkdir -p "$BENCH_DIR"
+# every version is compiled under the same name, which is part of each
+# class's tree
+src="$BENCH_DIR/program.cl"
+base="$BENCH_DIR/base_c${BENCH_CLASSES}_s${BENCH_SEED}.cl"
+cache="$BENCH_DIR/phase.cache"
+
+"$COOLGEN" -classes "$BENCH_CLASSES" -seed "$BENCH_SEED" > "$base" || exit 1
+
+export COOL_BINARY_AST=1
+
+# ast version edit
+ast() {
+  case $2 in
+    none)  cp "$base" "$src" ;;
+    body)  # the first integer literal in the methods of C1
+      awk '/^class C1 / { in1 = 1 }
+           in1 && !done && body && match($0, /[ (~]-?[0-9]+[;) ]/) {
+               $0 = substr($0, 1, RSTART) "424242" substr($0, RSTART + RLENGTH - 1); done = 1 }
+           in1 && /\{ \{/ { body = 1 }
+           { print }' "$base" > "$src" ;;
+    iface) sed '/^class C0 /s/{/{ bench_attr : Int;/' "$base" > "$src" ;;
+    shift) { echo "-- moves every class down a line"; cat "$base"; } > "$src" ;;
+  esac
+  "$LEXER" "$src" | "$PARSER" "$src" > "$BENCH_DIR/$1.ast"
+  "$SEMANT" "$src" < "$BENCH_DIR/$1.ast" > "$BENCH_DIR/$1.typed" || exit 1
+}
+
+now_ns() { date +%s%N; }
+
+#
+# run_mode phase name input cache_from
+#
+# cache_from is the cache file to start from, "" for none and "-" for an
+# empty one.
+#
+run_mode() {
+  local phase=$1 mode=$2 input=$3 from=$4 best="" t0 t1 ns r exe var
+  case $phase in
+    semant) exe=$SEMANT var=COOL_SEMANT_CACHE ;;
+    cgen)   exe=$CGEN var=COOL_CGEN_CACHE ;;
+  esac
+  for ((r = 0; r < BENCH_REPEAT; r++)); do
+    case $from in
+      "") unset $var ;;
+      -)  rm -f "$cache"; export $var=$cache ;;
+      *)  cp "$from" "$cache"; export $var=$cache ;;
+    esac
+    t0=$(now_ns)
+    "$exe" "$src" < "$BENCH_DIR/$input" > /dev/null || {
+      echo "incremental-bench: $phase failed in $mode mode" >&2
+      return 1
+    }
+    t1=$(now_ns)
+    ns=$((t1 - t0))
+    if [ -z "$best" ] || [ "$ns" -lt "$best" ]; then best=$ns; fi
+  done
+  unset $var
+  awk -v phase="$phase" -v mode="$mode" -v classes="$BENCH_CLASSES" -v ns="$best" 'BEGIN {
+    printf "{\"phase\":\"%s\",\"mode\":\"%s\",\"classes\":%d,\"seconds\":%.6f}\n",
+      phase, mode, classes, ns / 1e9;
+  }'
+}
+
+ast base none
+ast body body
+ast iface iface
+ast shift shift
+
+for phase in semant cgen; do
+  case $phase in
+    semant) in=ast ;;
+    cgen)   in=typed ;;
+  esac
+  run_mode $phase full base.$in ""
+  run_mode $phase cold base.$in -
+  cp "$cache" "$BENCH_DIR/base.cache"
+  run_mode $phase unchanged base.$in "$BENCH_DIR/base.cache"
+  run_mode $phase body_edit body.$in "$BENCH_DIR/base.cache"
+  run_mode $phase iface_edit iface.$in "$BENCH_DIR/base.cache"
+  run_mode $phase line_shift shift.$in "$BENCH_DIR/base.cache"
+done
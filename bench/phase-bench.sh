@@ -0,0 +1,200 @@
+#!/bin/bash
+#
+#  phase-bench.sh
+#              Throughput benchmark for the four compiler phases.
+#
+#  Every phase is run in isolation: the input of a phase is produced once
+#  by running the earlier phases, then only the phase under test is timed
+#  on that saved input.
+#
+#      lex     PA2 lexer    .cl file          -> tokens/sec
+#      parse   PA3 parser   token stream      -> AST nodes/sec
+#      semant  PA4 semant   untyped AST dump  -> classes/sec
+#      cgen    PA5 cgen     typed AST dump    -> bytes of assembly/sec
+#
+#  lex_fread is lex reading the source through fread instead of scanning
+#  it in place from a mapping (COOL_LEX_MMAP=0); its rate in bytes/sec is
+#  input_bytes / seconds.
+#
+#  lex_packed and parse_packed are lex and parse with the packed token
+#  stream (COOL_PACKED_TOKENS, see ../common/tokens.h) in place of the
+#  text one, for comparison with the per-token text interface.
+#
+#  parse_pratt is parse_packed with the hand-written parser
+#  (COOL_PARSE_WITH=pratt, see ../PA3/pratt.h); its peak_rss_kb is the
+#  one to compare with parse_packed.  Every input is also parsed once with
+#  COOL_PARSE_WITH=diff, which fails if the two parsers disagree.
+#
+#  lex_jobs and parse_jobs split a file at top-level classes and work on
+#  the parts at once: lex_jobs is lex_packed with COOL_LEX_JOBS, parse_jobs
+#  parse_pratt with COOL_PARSE_JOBS, both set to BENCH_JOBS.  Parts under
+#  256KB are not split off, so the small inputs show no gain.
+#
+#  The input set is size-parameterized along five axes (number of classes,
+#  depth of the inheritance chains, expressions per method, number of string
+#  literals, branches per case expression).  Each axis is swept on its own
+#  around a base point so that the scaling of one axis can be read off
+#  directly.  Inputs are written by coolgen, which is built on first use.
+#
+#  Output is one JSON object per line (phase x input) on stdout, e.g.
+#
+#    {"phase":"lex","input":"c100_d5_m20_l100","classes":100,"depth":5,
+#     "method_size":20,"literals":100,"cases":10,"input_bytes":51234,"count":9876,
+#     "unit":"tokens","seconds":0.0123,"rate":802926.8,"peak_rss_kb":1432}
+#
+#  Environment:
+#      COOL_LEXER COOL_PARSER COOL_SEMANT COOL_CGEN   phase executables
+#                               (default: the ones built in ../PA2 .. ../PA5)
+#      BENCH_DIR                where inputs and intermediates are kept
+#      BENCH_REPEAT             runs per measurement, the fastest is kept (3)
+#      BENCH_JOBS               processes/threads for lex_jobs and parse_jobs
+#                               (the number of CPUs)
+#      BENCH_SEED               seed given to coolgen (1)
+#      BENCH_BASE               base point
+#                               "classes depth method_size literals cases"
+#      BENCH_CLASSES BENCH_DEPTH BENCH_METHOD_SIZE BENCH_LITERALS BENCH_CASES
+#                               values swept along each axis
+#
+
+top=$(cd "$(dirname "$0")/.." && pwd)
+
+LEXER=${COOL_LEXER:-$top/PA2/lexer}
+PARSER=${COOL_PARSER:-$top/PA3/parser}
+SEMANT=${COOL_SEMANT:-$top/PA4/semant}
+CGEN=${COOL_CGEN:-$top/PA5/cgen}
+
+BENCH_DIR=${BENCH_DIR:-${TMPDIR:-/tmp}/cool-phase-bench}
+BENCH_REPEAT=${BENCH_REPEAT:-3}
+BENCH_JOBS=${BENCH_JOBS:-$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)}
+BENCH_SEED=${BENCH_SEED:-1}
+BENCH_BASE=${BENCH_BASE:-"100 5 20 100 10"}
+BENCH_CLASSES=${BENCH_CLASSES:-"10 100 1000 4000"}
+BENCH_DEPTH=${BENCH_DEPTH:-"1 10 50 100"}
+BENCH_METHOD_SIZE=${BENCH_METHOD_SIZE:-"10 100 1000 10000"}
+BENCH_LITERALS=${BENCH_LITERALS:-"10 1000 10000 50000"}
+BENCH_CASES=${BENCH_CASES:-"0 10 100 500"}
+
+COOLGEN=${COOLGEN:-$top/bench/coolgen}
+if [ ! -x "$COOLGEN" ]; then
+  ${CXX:-g++} -O2 -o "$COOLGEN" "$top/bench/coolgen.cc" || exit 1
+fi
+
+for exe in "$LEXER" "$PARSER" "$SEMANT" "$CGEN"; do
+  if [ ! -x "$exe" ]; then
+    echo "phase-bench: $exe is not built" >&2
+    exit 1
+  fi
+done
+
+# GNU time reports the peak resident set size; without it we report null.
+if [ -x /usr/bin/time ] && /usr/bin/time -f %M true >/dev/null 2>&1; then
+  have_time=1
+else
+  have_time=0
+fi
+
+mkdir -p "$BENCH_DIR"
+
+#
+# gen_input classes depth method_size literals cases
+#
+# Writes a semantically valid COOL program of the requested shape to stdout
+# (see coolgen.cc).  The generator is seeded, so a given point of the input
+# set is the same program from run to run.
+#
+gen_input() {
+  "$COOLGEN" -classes "$1" -depth "$2" -block "$3" -strings "$4" -cases "$5" \
+             -seed "$BENCH_SEED"
+}
+
+# now_ns: wall clock in nanoseconds
+now_ns() { date +%s%N; }
+
+#
+# run_phase name unit count input_bytes exe stdin_file [args...]
+#
+# Times `exe args < stdin_file' BENCH_REPEAT times and prints one record
+# for the fastest run.  A count of "out" stands for the size in bytes of
+# what the phase wrote.
+#
+run_phase() {
+  local phase=$1 unit=$2 count=$3 bytes=$4 exe=$5 in=$6
+  shift 6
+  local best="" rss=null t0 t1 ns r
+  for ((r = 0; r < BENCH_REPEAT; r++)); do
+    t0=$(now_ns)
+    "$exe" "$@" < "$in" > "$BENCH_DIR/phase.out" 2>/dev/null
+    t1=$(now_ns)
+    ns=$((t1 - t0))
+    if [ -z "$best" ] || [ "$ns" -lt "$best" ]; then best=$ns; fi
+  done
+  if [ "$count" = out ]; then count=$(wc -c < "$BENCH_DIR/phase.out"); fi
+  if [ "$have_time" = 1 ]; then
+    rss=$( { /usr/bin/time -f %M "$exe" "$@" < "$in" > /dev/null 2>/dev/null; } 2>&1 | tail -1)
+  fi
+  awk -v phase="$phase" -v input="$name" -v c="$cls" -v d="$dep" -v m="$msz" \
+      -v l="$lits" -v k="$ncase" -v bytes="$bytes" -v count="$count" -v unit="$unit" \
+      -v ns="$best" -v rss="$rss" 'BEGIN {
+    s = ns / 1e9;
+    printf "{\"phase\":\"%s\",\"input\":\"%s\",\"classes\":%d,\"depth\":%d,", phase, input, c, d;
+    printf "\"method_size\":%d,\"literals\":%d,\"cases\":%d,", m, l, k;
+    printf "\"input_bytes\":%d,\"count\":%d,", bytes, count;
+    printf "\"unit\":\"%s\",\"seconds\":%.6f,\"rate\":%.1f,\"peak_rss_kb\":%s}\n", unit, s,
+           (s > 0 ? count / s : 0), rss;
+  }'
+}
+
+#
+# bench_one classes depth method_size literals cases
+#
+bench_one() {
+  cls=$1 dep=$2 msz=$3 lits=$4 ncase=$5
+  name="c${cls}_d${dep}_m${msz}_l${lits}_k${ncase}_s${BENCH_SEED}"
+  local src="$BENCH_DIR/$name.cl"
+  local tok="$BENCH_DIR/$name.tok"
+  local ast="$BENCH_DIR/$name.ast"
+  local typed="$BENCH_DIR/$name.typed"
+  local ptok="$BENCH_DIR/$name.ptok"
+
+  [ -f "$src" ] || gen_input "$cls" "$dep" "$msz" "$lits" "$ncase" > "$src"
+
+  # Produce the input of every phase once.
+  "$LEXER" "$src" > "$tok" &&
+  COOL_PACKED_TOKENS=1 "$LEXER" "$src" > "$ptok" &&
+  "$PARSER" "$src" < "$tok" > "$ast" &&
+  COOL_PARSE_WITH=diff "$PARSER" "$src" < "$ptok" > /dev/null &&
+  "$SEMANT" "$src" < "$ast" > "$typed" || {
+    echo "phase-bench: front end failed on $src" >&2
+    return 1
+  }
+
+  local ntok nnodes ncls
+  ntok=$(($(wc -l < "$tok") - 1))               # minus the #name line
+  nnodes=$(grep -c '^ *_[a-z]' "$ast")          # one line per node
+  ncls=$(grep -c '^ *_class$' "$ast")
+
+  run_phase lex    tokens    "$ntok"   "$(wc -c < "$src")"   "$LEXER"  /dev/null "$src"
+  run_phase parse  nodes     "$nnodes" "$(wc -c < "$tok")"   "$PARSER" "$tok"
+  run_phase lex_fread    tokens "$ntok"   "$(wc -c < "$src")"  env /dev/null \
+            COOL_LEX_MMAP=0 "$LEXER" "$src"
+  run_phase lex_packed   tokens "$ntok"   "$(wc -c < "$src")"  env /dev/null \
+            COOL_PACKED_TOKENS=1 "$LEXER" "$src"
+  run_phase parse_packed nodes  "$nnodes" "$(wc -c < "$ptok")" "$PARSER" "$ptok"
+  run_phase parse_pratt  nodes  "$nnodes" "$(wc -c < "$ptok")" env "$ptok" \
+            COOL_PARSE_WITH=pratt "$PARSER"
+  run_phase lex_jobs     tokens "$ntok"   "$(wc -c < "$src")"  env /dev/null \
+            COOL_PACKED_TOKENS=1 COOL_LEX_JOBS="$BENCH_JOBS" "$LEXER" "$src"
+  run_phase parse_jobs   nodes  "$nnodes" "$(wc -c < "$ptok")" env "$ptok" \
+            COOL_PARSE_WITH=pratt COOL_PARSE_JOBS="$BENCH_JOBS" "$PARSER"
+  run_phase semant classes   "$ncls"   "$(wc -c < "$ast")"   "$SEMANT" "$ast"
+  run_phase cgen   asm_bytes out       "$(wc -c < "$typed")" "$CGEN"   "$typed"
+}
+
+set -- $BENCH_BASE
+base_c=$1 base_d=$2 base_m=$3 base_l=$4 base_k=$5
+
+for v in $BENCH_CLASSES;     do bench_one "$v" "$base_d" "$base_m" "$base_l" "$base_k"; done
+for v in $BENCH_DEPTH;       do bench_one "$base_c" "$v" "$base_m" "$base_l" "$base_k"; done
+for v in $BENCH_METHOD_SIZE; do bench_one "$base_c" "$base_d" "$v" "$base_l" "$base_k"; done
+for v in $BENCH_LITERALS;    do bench_one "$base_c" "$base_d" "$base_m" "$v" "$base_k"; done
+for v in $BENCH_CASES;       do bench_one "$base_c" "$base_d" "$base_m" "$base_l" "$v"; done
@@ -0,0 +1,86 @@
+#!/bin/bash
+#
+#  pipeline-bench.sh
+#              End-to-end time of  lexer | parser | semant | cgen  with the
+#              text AST dump and with the binary AST between the phases.
+#
+#  The input is a coolgen program grown to about BENCH_LINES lines (50000
+#  by default).  Each mode is run BENCH_REPEAT times and the fastest run is
+#  kept.  Output is one JSON object per mode on stdout, e.g.
+#
+#    {"mode":"binary","lines":50112,"seconds":1.234567,"parse_out_bytes":812345,
+#     "semant_out_bytes":934567}
+#
+#  where *_out_bytes are the sizes of what the parser and semant hand on.
+#
+#  Environment: COOL_LEXER COOL_PARSER COOL_SEMANT COOL_CGEN, BENCH_DIR,
+#  BENCH_REPEAT and BENCH_SEED as for phase-bench.sh, and BENCH_LINES.
+#
+
+top=$(cd "$(dirname "$0")/.." && pwd)
+
+LEXER=${COOL_LEXER:-$top/PA2/lexer}
+PARSER=${COOL_PARSER:-$top/PA3/parser}
+SEMANT=${COOL_SEMANT:-$top/PA4/semant}
+CGEN=${COOL_CGEN:-$top/PA5/cgen}
+
+BENCH_DIR=${BENCH_DIR:-${TMPDIR:-/tmp}/cool-pipeline-bench}
+BENCH_REPEAT=${BENCH_REPEAT:-3}
+BENCH_SEED=${BENCH_SEED:-1}
+BENCH_LINES=${BENCH_LINES:-50000}
+
+COOLGEN=${COOLGEN:-$top/bench/coolgen}
+if [ ! -x "$COOLGEN" ]; then
+  ${CXX:-g++} -O2 -o "$COOLGEN" "$top/bench/coolgen.cc" || exit 1
+fi
+
+for exe in "$LEXER" "$PARSER" "$SEMANT" "$CGEN"; do
+  if [ ! -x "$exe" ]; then
+    echo "pipeline-bench: $exe is not built" >&2
+    exit 1
+  fi
+done
+
+mkdir -p "$BENCH_DIR"
+src="$BENCH_DIR/pipeline_n${BENCH_LINES}_s${BENCH_SEED}.cl"
+
+# Grow the class count from the size of a 100-class program.
+if [ ! -f "$src" ]; then
+  per100=$("$COOLGEN" -classes 100 -seed "$BENCH_SEED" | wc -l)
+  classes=$(( (BENCH_LINES * 100 + per100 - 1) / per100 ))
+  "$COOLGEN" -classes "$classes" -seed "$BENCH_SEED" > "$src" || exit 1
+fi
+lines=$(wc -l < "$src")
+
+now_ns() { date +%s%N; }
+
+#
+# run_mode name
+#
+# COOL_BINARY_AST is taken from the caller's environment.
+#
+run_mode() {
+  local mode=$1 best="" t0 t1 ns r
+  local ast="$BENCH_DIR/pipeline.$mode.ast" typed="$BENCH_DIR/pipeline.$mode.typed"
+  for ((r = 0; r < BENCH_REPEAT; r++)); do
+    t0=$(now_ns)
+    "$LEXER" "$src" | "$PARSER" "$src" | "$SEMANT" "$src" | "$CGEN" -o "$BENCH_DIR/pipeline.s" "$src" || {
+      echo "pipeline-bench: pipeline failed in $mode mode" >&2
+      return 1
+    }
+    t1=$(now_ns)
+    ns=$((t1 - t0))
+    if [ -z "$best" ] || [ "$ns" -lt "$best" ]; then best=$ns; fi
+  done
+  # sizes of the intermediates, outside of the timed runs
+  "$LEXER" "$src" | "$PARSER" "$src" > "$ast"
+  "$SEMANT" "$src" < "$ast" > "$typed"
+  awk -v mode="$mode" -v lines="$lines" -v ns="$best" \
+      -v a="$(wc -c < "$ast")" -v t="$(wc -c < "$typed")" 'BEGIN {
+    printf "{\"mode\":\"%s\",\"lines\":%d,\"seconds\":%.6f,", mode, lines, ns / 1e9;
+    printf "\"parse_out_bytes\":%d,\"semant_out_bytes\":%d}\n", a, t;
+  }'
+}
+
+COOL_BINARY_AST= run_mode text
+COOL_BINARY_AST=1 run_mode binary
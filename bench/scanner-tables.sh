@@ -0,0 +1,58 @@
+#!/bin/bash
+#
+#  scanner-tables.sh
+#              Size of the tables flex generates for one or more scanner
+#              definitions.
+#
+#  For each .flex file given (default: ../PA2/cool.flex) prints one JSON
+#  object with the number of DFA states, the table entries flex reports
+#  as needed and the size in bytes of the yy_* table arrays in the
+#  generated scanner, e.g.
+#
+#    {"scanner":"PA2/cool.flex","dfa_states":160,"table_entries":1234,
+#     "table_bytes":5678}
+#
+#  To compare with an earlier version of the scanner:
+#
+#      git show <rev>:PA2/cool.flex > /tmp/cool-old.flex
+#      bench/scanner-tables.sh /tmp/cool-old.flex PA2/cool.flex
+#
+#  Scanning speed (tokens/sec) is the lex row of phase-bench.sh.
+#
+#  Environment: FLEX (default: flex), FLEX_FLAGS (default: none, i.e. the
+#  compressed tables the course Makefile builds).
+#
+
+top=$(cd "$(dirname "$0")/.." && pwd)
+FLEX=${FLEX:-flex}
+
+[ $# -gt 0 ] || set -- "$top/PA2/cool.flex"
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+for f in "$@"; do
+  out="$work/scanner.cc"
+  stats=$("$FLEX" -v $FLEX_FLAGS -o "$out" "$f" 2>&1 >/dev/null) || {
+    echo "scanner-tables: $FLEX failed on $f" >&2
+    echo "$stats" >&2
+    exit 1
+  }
+  states=$(echo "$stats" | sed -n 's@^ *\([0-9]*\)/[0-9]* DFA states.*@\1@p' | head -1)
+  entries=$(echo "$stats" | sed -n 's@^ *\([0-9]*\) total table entries needed.*@\1@p' | head -1)
+  # Add up the yy_* static arrays: element size times element count.
+  bytes=$(awk '
+    /^static (yyconst |const )?flex_int(16|32)_t yy_[a-z_]*\[[0-9]+\]/ ||
+    /^static (yyconst |const )?YY_CHAR yy_[a-z_]*\[[0-9]+\]/ ||
+    /^static (yyconst |const )?short int yy_[a-z_]*\[[0-9]+\]/ ||
+    /^static (yyconst |const )?int yy_[a-z_]*\[[0-9]+\]/ {
+      size = 4
+      if ($0 ~ /int16|short/) size = 2
+      if ($0 ~ /YY_CHAR/) size = 1           # typedef flex_uint8_t YY_CHAR
+      match($0, /\[[0-9]+\]/)
+      total += size * substr($0, RSTART + 1, RLENGTH - 2)
+    }
+    END { print total + 0 }' "$out")
+  printf '{"scanner":"%s","dfa_states":%s,"table_entries":%s,"table_bytes":%s}\n' \
+         "${f#$top/}" "${states:-null}" "${entries:-null}" "$bytes"
+done
@@ -0,0 +1,47 @@
+//////////////////////////////////////////////////////////////////////
+//
+// arena.cc
+//
+// Implementation of the bump allocator declared in arena.h.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include "arena.h"
+
+Arena compile_arena;
+
+//The chunk header is rounded up so that the first object is aligned.
+static const size_t CHUNK_HEADER = 32;
+
+//Starts a new chunk.  A request larger than a quarter of a chunk gets a
+//chunk of its own, which goes behind the current one so that the space
+//left in the current chunk is not wasted.
+void* Arena::allocate_slow(size_t size) {
+	bool own = size > chunk_size / 4;
+	size_t usable = own ? size : chunk_size;
+	Chunk* c = (Chunk*) malloc(CHUNK_HEADER + usable);
+	if(c == NULL) throw std::bad_alloc();
+	c->size = usable;
+	char* data = (char*) c + CHUNK_HEADER;
+	if(own && chunks != NULL) {
+		c->next = chunks->next;
+		chunks->next = c;
+		return data;
+	}
+	c->next = chunks;
+	chunks = c;
+	next = data + size;
+	limit = data + usable;
+	return data;
+}
+
+void Arena::release() {
+	while(chunks != NULL) {
+		Chunk* c = chunks;
+		chunks = c->next;
+		free(c);
+	}
+	next = limit = NULL;
+	n_objects = n_bytes = 0;
+}
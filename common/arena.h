@@ -0,0 +1,90 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+//////////////////////////////////////////////////////////////////////
+//
+// Arena allocation
+//
+// An Arena hands out memory by bumping a pointer through large chunks
+// and frees everything at once in release().  Objects in an arena are
+// never destroyed one at a time: their destructors do not run and
+// operator delete on them does nothing.
+//
+// compile_arena holds everything that lives as long as a compilation
+// unit: AST nodes (in the order they are built, so a traversal walks
+// memory mostly forward) and the compiler's own tables.  A driver that
+// compiles more than one unit in a process calls
+// compile_arena.release() when it is done with a unit; a phase that
+// exits after one unit does not need to.
+//
+// Arenas are not thread safe; a worker thread uses an Arena of its own.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stddef.h>
+#include <new>
+#include <utility>
+
+class Arena {
+private:
+	struct Chunk {
+		Chunk* next;
+		size_t size;		//bytes usable after the header
+	};
+	Chunk* chunks;			//most recent chunk first
+	char* next;				//first free byte in chunks
+	char* limit;			//end of chunks
+	size_t chunk_size;
+	long n_objects;			//allocations since the last release()
+	long n_bytes;
+
+	void* allocate_slow(size_t size);
+	Arena(const Arena&);
+	Arena& operator=(const Arena&);
+public:
+	static const size_t alignment = 16;	//of every object handed out
+
+	//constexpr so that compile_arena is ready before any static constructor
+	constexpr Arena(size_t chunk_size = 64 * 1024) :
+			chunks(NULL),
+			next(NULL),
+			limit(NULL),
+			chunk_size(chunk_size),
+			n_objects(0),
+			n_bytes(0) {
+	}
+	~Arena() { release(); }
+
+	void* allocate(size_t size) {
+		size = (size + alignment - 1) & ~(alignment - 1);
+		n_objects++;
+		n_bytes += size;
+		if((size_t) (limit - next) < size)
+			return allocate_slow(size);
+		void* p = next;
+		next += size;
+		return p;
+	}
+
+	//Frees every chunk.  All pointers into the arena become invalid.
+	void release();
+
+	long objects() const { return n_objects; }
+	long bytes() const { return n_bytes; }
+};
+
+extern Arena compile_arena;
+
+//Allocates a T in compile_arena.
+template <class T, class... Args>
+T* arena_new(Args&&... args) {
+	return new (compile_arena.allocate(sizeof(T))) T(std::forward<Args>(args)...);
+}
+
+//Placed in a class body, puts objects of that class and of every class
+//derived from it in compile_arena.
+#define ARENA_ALLOCATED                                                        \
+   static void* operator new(size_t size) { return compile_arena.allocate(size); } \
+   static void operator delete(void*) {}
+
+#endif
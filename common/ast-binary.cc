@@ -0,0 +1,563 @@
+//////////////////////////////////////////////////////////////////////
+//
+// ast-binary.cc
+//
+// Writer and reader of the binary AST form described in ast-binary.h.
+// This file is compiled in each phase against that phase's cool-tree.h.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ast-binary.h"
+#include "fingerprint.h"
+#include "symbol-section.h"
+
+extern int node_lineno;		//line given to the next node built (tree.cc)
+
+//////////////////////////////////////////////////////////////////////
+//
+// Writing
+//
+// Every constructor writes its subtrees, in field order, and then its
+// own record.
+//
+//////////////////////////////////////////////////////////////////////
+
+uint32_t AstWriter::intern(AstTable table, Symbol s) {
+	if(shared != NULL) {
+		std::map<Symbol, uint32_t>::const_iterator found = shared->index[table].find(s);
+		assert(found != shared->index[table].end());
+		return found->second;
+	}
+	std::map<Symbol, uint32_t>::iterator it = index[table].find(s);
+	if(it != index[table].end())
+		return it->second;
+	uint32_t i = symbols[table].size();
+	index[table][s] = i;
+	symbols[table].push_back(s);
+	return i;
+}
+
+//The fingerprint of a symbol of table with text s, whatever its index.
+static uint64_t symbol_print(int table, const char* s, uint32_t len) {
+	return fingerprint(s, len, fingerprint(&table, sizeof(table)));
+}
+
+void AstWriter::fold(uint64_t x) {
+	print = fingerprint(&x, sizeof(x), print);
+}
+
+void AstWriter::symbol(AstTable table, Symbol s) {
+	if(printing)
+		fold(symbol_print(table, s->get_string(), s->get_len()));
+	else
+		word(intern(table, s));
+}
+
+void AstWriter::type(Symbol s) {
+	if(s == NULL || is_no_type(s))
+		word(0);
+	else if(printing)
+		symbol(AST_IDTABLE, s);
+	else
+		word(intern(AST_IDTABLE, s) + 1);
+}
+
+//Lines as AstReader::read counts them, in 32 bits: the class's own
+//record comes after those of its features, with an earlier line.
+void AstWriter::print_node(AstKind kind, int line) {
+	if(first_line == 0)
+		first_line = line;
+	fold(kind | (uint64_t) (uint32_t) (line == 0 ? 0 : line - first_line + 1) << 8);
+}
+
+void AstWriter::image(std::vector<uint32_t>& out) {
+	std::vector<uint32_t> syms;
+	AstHeader h;
+	memcpy(h.magic, AST_MAGIC, sizeof(h.magic));
+	h.version = AST_VERSION;
+	for(int t = 0; t < AST_TABLES; t++) {
+		h.n_symbols[t] = symbols[t].size();
+		for(size_t i = 0; i < symbols[t].size(); i++) {
+			put_symbol_entry(syms, symbols[t][i]->get_string(), symbols[t][i]->get_len());
+		}
+	}
+	h.symbol_words = syms.size();
+	h.n_words = words.size();
+	const uint32_t* head = (const uint32_t*) &h;
+	out.assign(head, head + sizeof(h) / sizeof(uint32_t));
+	out.insert(out.end(), syms.begin(), syms.end());
+	out.insert(out.end(), words.begin(), words.end());
+}
+
+void AstWriter::write(std::ostream& out) {
+	std::vector<uint32_t> file;
+	image(file);
+	out.write((const char*) file.data(), file.size() * sizeof(uint32_t));
+	out.flush();
+}
+
+void program_class::write_binary(AstWriter& w) {
+	w.list(AST_CLASSES, classes);
+	w.node(AST_PROGRAM, this);
+}
+
+void class__class::write_binary(AstWriter& w) {
+	w.list(AST_FEATURES, features);
+	w.node(AST_CLASS, this);
+	w.id(name);
+	w.id(parent);
+	w.str(filename);
+}
+
+void method_class::write_binary(AstWriter& w) {
+	w.list(AST_FORMALS, formals);
+	expr->write_binary(w);
+	w.node(AST_METHOD, this);
+	w.id(name);
+	w.id(return_type);
+}
+
+void attr_class::write_binary(AstWriter& w) {
+	init->write_binary(w);
+	w.node(AST_ATTR, this);
+	w.id(name);
+	w.id(type_decl);
+}
+
+void formal_class::write_binary(AstWriter& w) {
+	w.node(AST_FORMAL, this);
+	w.id(name);
+	w.id(type_decl);
+}
+
+void branch_class::write_binary(AstWriter& w) {
+	expr->write_binary(w);
+	w.node(AST_BRANCH, this);
+	w.id(name);
+	w.id(type_decl);
+}
+
+void assign_class::write_binary(AstWriter& w) {
+	expr->write_binary(w);
+	w.node(AST_ASSIGN, this);
+	w.id(name);
+	w.type(type);
+}
+
+void static_dispatch_class::write_binary(AstWriter& w) {
+	expr->write_binary(w);
+	w.list(AST_EXPRESSIONS, actual);
+	w.node(AST_STATIC_DISPATCH, this);
+	w.id(type_name);
+	w.id(name);
+	w.type(type);
+}
+
+void dispatch_class::write_binary(AstWriter& w) {
+	expr->write_binary(w);
+	w.list(AST_EXPRESSIONS, actual);
+	w.node(AST_DISPATCH, this);
+	w.id(name);
+	w.type(type);
+}
+
+void cond_class::write_binary(AstWriter& w) {
+	pred->write_binary(w);
+	then_exp->write_binary(w);
+	else_exp->write_binary(w);
+	w.node(AST_COND, this);
+	w.type(type);
+}
+
+void loop_class::write_binary(AstWriter& w) {
+	pred->write_binary(w);
+	body->write_binary(w);
+	w.node(AST_LOOP, this);
+	w.type(type);
+}
+
+void typcase_class::write_binary(AstWriter& w) {
+	expr->write_binary(w);
+	w.list(AST_CASES, cases);
+	w.node(AST_TYPCASE, this);
+	w.type(type);
+}
+
+void block_class::write_binary(AstWriter& w) {
+	w.list(AST_EXPRESSIONS, body);
+	w.node(AST_BLOCK, this);
+	w.type(type);
+}
+
+void let_class::write_binary(AstWriter& w) {
+	init->write_binary(w);
+	body->write_binary(w);
+	w.node(AST_LET, this);
+	w.id(identifier);
+	w.id(type_decl);
+	w.type(type);
+}
+
+//binary and unary operators
+#define WRITE_BINOP(ctor, kind)              \
+void ctor##_class::write_binary(AstWriter& w) { \
+	e1->write_binary(w);                     \
+	e2->write_binary(w);                     \
+	w.node(kind, this);                      \
+	w.type(type);                            \
+}
+#define WRITE_UNOP(ctor, kind)               \
+void ctor##_class::write_binary(AstWriter& w) { \
+	e1->write_binary(w);                     \
+	w.node(kind, this);                      \
+	w.type(type);                            \
+}
+
+WRITE_BINOP(plus, AST_PLUS)
+WRITE_BINOP(sub, AST_SUB)
+WRITE_BINOP(mul, AST_MUL)
+WRITE_BINOP(divide, AST_DIVIDE)
+WRITE_UNOP(neg, AST_NEG)
+WRITE_BINOP(lt, AST_LT)
+WRITE_BINOP(eq, AST_EQ)
+WRITE_BINOP(leq, AST_LEQ)
+WRITE_UNOP(comp, AST_COMP)
+WRITE_UNOP(isvoid, AST_ISVOID)
+
+void int_const_class::write_binary(AstWriter& w) {
+	w.node(AST_INT_CONST, this);
+	w.integer(token);
+	w.type(type);
+}
+
+void bool_const_class::write_binary(AstWriter& w) {
+	w.node(AST_BOOL_CONST, this);
+	w.word(val ? 1 : 0);
+	w.type(type);
+}
+
+void string_const_class::write_binary(AstWriter& w) {
+	w.node(AST_STRING_CONST, this);
+	w.str(token);
+	w.type(type);
+}
+
+void new__class::write_binary(AstWriter& w) {
+	w.node(AST_NEW, this);
+	w.id(type_name);
+	w.type(type);
+}
+
+void no_expr_class::write_binary(AstWriter& w) {
+	w.node(AST_NO_EXPR, this);
+	w.type(type);
+}
+
+void object_class::write_binary(AstWriter& w) {
+	w.node(AST_OBJECT, this);
+	w.id(name);
+	w.type(type);
+}
+
+bool ast_binary_requested() {
+	const char* v = getenv("COOL_BINARY_AST");
+	return v != NULL && *v != '\0' && strcmp(v, "0") != 0;
+}
+
+void write_binary_ast(Program p, std::ostream& out) {
+	AstWriter w;
+	p->write_binary(w);
+	w.write(out);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Reading
+//
+//////////////////////////////////////////////////////////////////////
+
+bool ast_input_is_binary(FILE* f) {
+	int c = getc(f);
+	if(c == EOF) return false;
+	ungetc(c, f);
+	return c == AST_MAGIC[0];
+}
+
+//The fingerprints of the classes read so far.
+static std::map<tree_node*, uint64_t> class_prints;
+
+uint64_t read_class_fingerprint(tree_node* c) {
+	std::map<tree_node*, uint64_t>::iterator it = class_prints.find(c);
+	return it == class_prints.end() ? 0 : it->second;
+}
+
+uint64_t class_records_fingerprint(Class_ c) {
+	uint64_t read = read_class_fingerprint(c);
+	if(read != 0)
+		return read;
+	AstWriter w;
+	w.printing = true;
+	w.print = FINGERPRINT_INIT;
+	w.first_line = 0;
+	c->write_binary(w);
+	return w.print;
+}
+
+static void malformed(const char* what) {
+	std::cerr << "malformed binary AST: " << what << std::endl;
+	exit(1);
+}
+
+class AstReader {
+private:
+	const uint32_t* w;
+	const uint32_t* end;
+	std::vector<Symbol> symbols[AST_TABLES];
+	std::vector<uint64_t> symbol_prints[AST_TABLES];	//of the text of each symbol
+	std::vector<tree_node*> stack;
+	uint64_t print;			//of the records since the last class
+	uint32_t first_line;	//of the first of them with a line; 0 before it
+
+	void fold(uint64_t x) { print = fingerprint(&x, sizeof(x), print); }
+	uint32_t raw() {
+		if(w == end) malformed("truncated node record");
+		return *w++;
+	}
+	uint32_t next() {
+		uint32_t x = raw();
+		fold(x);
+		return x;
+	}
+	Symbol sym(AstTable t) {
+		uint32_t i = raw();
+		if(i >= symbols[t].size()) malformed("symbol index out of range");
+		fold(symbol_prints[t][i]);
+		return symbols[t][i];
+	}
+	Symbol id() { return sym(AST_IDTABLE); }
+	Symbol str() { return sym(AST_STRINGTABLE); }
+	Symbol integer() { return sym(AST_INTTABLE); }
+	Expression typed(Expression e) {
+		uint32_t t = raw();
+		if(t > symbols[AST_IDTABLE].size()) malformed("type index out of range");
+		fold(t == 0 ? 0 : symbol_prints[AST_IDTABLE][t - 1]);
+		if(t != 0) e->set_type(symbols[AST_IDTABLE][t - 1]);
+		return e;
+	}
+	tree_node* pop() {
+		if(stack.empty()) malformed("missing subtree");
+		tree_node* t = stack.back();
+		stack.pop_back();
+		return t;
+	}
+	//The subtrees are popped in reverse field order.
+	Expression pop_expr() { return (Expression) pop(); }
+
+	template <class Elem>
+	list_node<Elem>* pop_list(list_node<Elem>* (*nil)(), list_node<Elem>* (*single)(Elem),
+			list_node<Elem>* (*append)(list_node<Elem>*, list_node<Elem>*)) {
+		uint32_t n = next();
+		if(n > stack.size()) malformed("list longer than the stack");
+		size_t base = stack.size() - n;
+		list_node<Elem>* l = nil();
+		for(size_t i = base; i < stack.size(); i++)
+			l = append(l, single((Elem) stack[i]));
+		stack.resize(base);
+		return l;
+	}
+public:
+	AstReader(const char* data, size_t size);
+	Program read();
+};
+
+AstReader::AstReader(const char* data, size_t size) : print(FINGERPRINT_INIT), first_line(0) {
+	if(size < sizeof(AstHeader)) malformed("no header");
+	const AstHeader* h = (const AstHeader*) data;
+	if(memcmp(h->magic, AST_MAGIC, sizeof(h->magic)) != 0) malformed("bad magic");
+	if(h->version != AST_VERSION) malformed("unknown version");
+	const uint32_t* p = (const uint32_t*) (data + sizeof(AstHeader));
+	const uint32_t* sym_end = p + h->symbol_words;
+	if((size - sizeof(AstHeader)) / sizeof(uint32_t) < (size_t) h->symbol_words + h->n_words)
+		malformed("truncated file");
+
+	for(int t = 0; t < AST_TABLES; t++) {
+		symbols[t].reserve(h->n_symbols[t]);
+		symbol_prints[t].reserve(h->n_symbols[t]);
+		for(uint32_t i = 0; i < h->n_symbols[t]; i++) {
+			uint32_t len;
+			char* s = get_symbol_entry(p, sym_end, len);		//add_string copies
+			if(s == NULL) malformed("truncated symbol section");
+			Symbol sym;
+			switch(t) {
+			case AST_IDTABLE: sym = idtable.add_string(s, len); break;
+			case AST_STRINGTABLE: sym = stringtable.add_string(s, len); break;
+			default: sym = inttable.add_string(s, len); break;
+			}
+			symbols[t].push_back(sym);
+			symbol_prints[t].push_back(symbol_print(t, s, len));
+		}
+	}
+	w = sym_end;
+	end = w + h->n_words;
+}
+
+Program AstReader::read() {
+	while(w != end) {
+		uint32_t head = *w++;
+		AstKind kind = (AstKind) (head & 0xff);
+		node_lineno = head >> 8;
+		//lines from the first of the class, so that moving the class in
+		//its file leaves the fingerprint alone
+		if(first_line == 0)
+			first_line = node_lineno;
+		fold(kind | (uint64_t) (node_lineno == 0 ? 0 : node_lineno - first_line + 1) << 8);
+		tree_node* t;
+		Expression e1, e2, e3;
+		Symbol s1, s2;
+		switch(kind) {
+		case AST_PROGRAM: {
+			Classes cs = (Classes) pop();
+			t = program(cs);
+			break;
+		}
+		case AST_CLASS: {
+			Features fs = (Features) pop();
+			s1 = id();
+			s2 = id();
+			t = class_(s1, s2, fs, str());
+			class_prints[t] = print;
+			print = FINGERPRINT_INIT;
+			first_line = 0;
+			break;
+		}
+		case AST_METHOD: {
+			e1 = pop_expr();
+			Formals fs = (Formals) pop();
+			s1 = id();
+			t = method(s1, fs, id(), e1);
+			break;
+		}
+		case AST_ATTR:
+			e1 = pop_expr();
+			s1 = id();
+			t = attr(s1, id(), e1);
+			break;
+		case AST_FORMAL:
+			s1 = id();
+			t = formal(s1, id());
+			break;
+		case AST_BRANCH:
+			e1 = pop_expr();
+			s1 = id();
+			t = branch(s1, id(), e1);
+			break;
+		case AST_ASSIGN:
+			e1 = pop_expr();
+			t = typed(assign(id(), e1));
+			break;
+		case AST_STATIC_DISPATCH: {
+			Expressions actual = (Expressions) pop();
+			e1 = pop_expr();
+			s1 = id();
+			s2 = id();
+			t = typed(static_dispatch(e1, s1, s2, actual));
+			break;
+		}
+		case AST_DISPATCH: {
+			Expressions actual = (Expressions) pop();
+			e1 = pop_expr();
+			t = typed(dispatch(e1, id(), actual));
+			break;
+		}
+		case AST_COND:
+			e3 = pop_expr();
+			e2 = pop_expr();
+			e1 = pop_expr();
+			t = typed(cond(e1, e2, e3));
+			break;
+		case AST_LOOP:
+			e2 = pop_expr();
+			e1 = pop_expr();
+			t = typed(loop(e1, e2));
+			break;
+		case AST_TYPCASE: {
+			Cases cases = (Cases) pop();
+			e1 = pop_expr();
+			t = typed(typcase(e1, cases));
+			break;
+		}
+		case AST_BLOCK:
+			t = typed(block((Expressions) pop()));
+			break;
+		case AST_LET:
+			e2 = pop_expr();
+			e1 = pop_expr();
+			s1 = id();
+			s2 = id();
+			t = typed(let(s1, s2, e1, e2));
+			break;
+		case AST_PLUS: e2 = pop_expr(); e1 = pop_expr(); t = typed(plus(e1, e2)); break;
+		case AST_SUB: e2 = pop_expr(); e1 = pop_expr(); t = typed(sub(e1, e2)); break;
+		case AST_MUL: e2 = pop_expr(); e1 = pop_expr(); t = typed(mul(e1, e2)); break;
+		case AST_DIVIDE: e2 = pop_expr(); e1 = pop_expr(); t = typed(divide(e1, e2)); break;
+		case AST_LT: e2 = pop_expr(); e1 = pop_expr(); t = typed(lt(e1, e2)); break;
+		case AST_EQ: e2 = pop_expr(); e1 = pop_expr(); t = typed(eq(e1, e2)); break;
+		case AST_LEQ: e2 = pop_expr(); e1 = pop_expr(); t = typed(leq(e1, e2)); break;
+		case AST_NEG: t = typed(neg(pop_expr())); break;
+		case AST_COMP: t = typed(comp(pop_expr())); break;
+		case AST_ISVOID: t = typed(isvoid(pop_expr())); break;
+		case AST_INT_CONST: t = typed(int_const(integer())); break;
+		case AST_BOOL_CONST: t = typed(bool_const(next() != 0)); break;
+		case AST_STRING_CONST: t = typed(string_const(str())); break;
+		case AST_NEW: t = typed(new_(id())); break;
+		case AST_NO_EXPR: t = typed(no_expr()); break;
+		case AST_OBJECT: t = typed(object(id())); break;
+		case AST_CLASSES: t = pop_list(nil_Classes, single_Classes, append_Classes); break;
+		case AST_FEATURES: t = pop_list(nil_Features, single_Features, append_Features); break;
+		case AST_FORMALS: t = pop_list(nil_Formals, single_Formals, append_Formals); break;
+		case AST_EXPRESSIONS: t = pop_list(nil_Expressions, single_Expressions, append_Expressions); break;
+		case AST_CASES: t = pop_list(nil_Cases, single_Cases, append_Cases); break;
+		default:
+			malformed("unknown node kind");
+		}
+		stack.push_back(t);
+	}
+	if(stack.size() != 1) malformed("node section is not one tree");
+	return (Program) stack.back();
+}
+
+Program read_binary_ast(FILE* f) {
+	struct stat st;
+	int fd = fileno(f);
+	if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(data != MAP_FAILED) {
+			AstReader reader((const char*) data, st.st_size);
+			Program p = reader.read();
+			munmap(data, st.st_size);
+			return p;
+		}
+	}
+	//pipes: read it all, into words so that the records are aligned
+	std::vector<uint32_t> buf(16 * 1024);
+	size_t size = 0;
+	size_t n;
+	while((n = fread((char*) buf.data() + size, 1, buf.size() * sizeof(uint32_t) - size, f)) > 0) {
+		size += n;
+		if(size == buf.size() * sizeof(uint32_t))
+			buf.resize(buf.size() * 2);
+	}
+	AstReader reader((const char*) buf.data(), size);
+	return reader.read();
+}
+
+Program read_binary_ast(const std::vector<uint32_t>& image) {
+	AstReader reader((const char*) image.data(), image.size() * sizeof(uint32_t));
+	return reader.read();
+}
@@ -0,0 +1,192 @@
+#ifndef AST_BINARY_H_
+#define AST_BINARY_H_
+
+//////////////////////////////////////////////////////////////////////
+//
+// Binary AST interchange
+//
+// The text dump of dump_with_types has to be tokenized and parsed again
+// by every phase that reads it.  The binary form is read with one pass
+// over an array of words and, when the input is a regular file, straight
+// out of an mmap of it.
+//
+// Layout (host byte order; every phase runs on the same machine):
+//
+//    AstHeader
+//    symbol section    idtable, then stringtable, then inttable entries
+//                      (see symbol-section.h)
+//    node section      n_words words of node records in postorder
+//
+// A node record is a word holding the kind (low 8 bits) and the line
+// number (the rest), then the operands of the constructor that are not
+// subtrees: symbols as indices into their table, Booleans as 0/1.  The
+// subtrees of a node are the records just before it, so a reader keeps
+// a stack.  A list is an AST_<phylum> record with the count of elements
+// that precede it.  Every expression record ends with its type: 0 for
+// none, otherwise 1 + the index of the type in idtable.  _no_type is
+// written as none, as the text dump reader reads it.
+//
+// Phases write the binary form instead of the text dump when
+// COOL_BINARY_AST is set; readers detect the form by its first byte.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <map>
+#include <vector>
+#include "cool-tree.h"
+
+#define AST_MAGIC      "\177COOLAST"
+#define AST_VERSION    1
+
+enum AstKind {
+	AST_PROGRAM = 1,
+	AST_CLASS,
+	AST_METHOD,
+	AST_ATTR,
+	AST_FORMAL,
+	AST_BRANCH,
+	AST_ASSIGN,
+	AST_STATIC_DISPATCH,
+	AST_DISPATCH,
+	AST_COND,
+	AST_LOOP,
+	AST_TYPCASE,
+	AST_BLOCK,
+	AST_LET,
+	AST_PLUS,
+	AST_SUB,
+	AST_MUL,
+	AST_DIVIDE,
+	AST_NEG,
+	AST_LT,
+	AST_EQ,
+	AST_LEQ,
+	AST_COMP,
+	AST_INT_CONST,
+	AST_BOOL_CONST,
+	AST_STRING_CONST,
+	AST_NEW,
+	AST_ISVOID,
+	AST_NO_EXPR,
+	AST_OBJECT,
+	//lists
+	AST_CLASSES,
+	AST_FEATURES,
+	AST_FORMALS,
+	AST_EXPRESSIONS,
+	AST_CASES
+};
+
+enum AstTable {
+	AST_IDTABLE,
+	AST_STRINGTABLE,
+	AST_INTTABLE,
+	AST_TABLES
+};
+
+struct AstHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t n_symbols[AST_TABLES];
+	uint32_t symbol_words;			//size of the symbol section
+	uint32_t n_words;				//size of the node section
+};
+
+class AstWriter {
+private:
+	std::vector<uint32_t> words;
+	std::map<Symbol, uint32_t> index[AST_TABLES];
+	std::vector<Symbol> symbols[AST_TABLES];
+	const AstWriter* shared;		//holds the symbols, if not this
+	int line_base;					//lines are written counted from it
+	//class_records_fingerprint's writer keeps no records, only the
+	//fingerprint AstReader takes of them
+	bool printing;
+	uint64_t print;
+	int first_line;					//of the first record with a line
+
+	uint32_t intern(AstTable table, Symbol s);
+	static bool is_no_type(Symbol s) {
+		return s->get_len() == 8 && memcmp(s->get_string(), "_no_type", 8) == 0;
+	}
+	void fold(uint64_t x);
+	void print_node(AstKind kind, int line);
+	void symbol(AstTable table, Symbol s);
+	friend uint64_t class_records_fingerprint(Class_ c);
+public:
+	AstWriter() : shared(NULL), line_base(0), printing(false) { }
+	//A writer for part of the records of symbols, which must already hold
+	//every symbol the part uses; parts can be written by several threads.
+	explicit AstWriter(const AstWriter* symbols) : shared(symbols), line_base(0), printing(false) { }
+	//Writes the nonzero lines of tree nodes counted from line (1 for line
+	//itself), so the records of a part do not change when it moves.
+	void lines_from(int line) { line_base = line - 1; }
+
+	void node(AstKind kind, tree_node* t) { node(kind, t->get_line_number()); }
+	void node(AstKind kind, int line) {
+		if(printing) print_node(kind, line);
+		else word(kind | (uint32_t) (line == 0 ? 0 : line - line_base) << 8);
+	}
+	void word(uint32_t w) { if(printing) fold(w); else words.push_back(w); }
+	void id(Symbol s) { symbol(AST_IDTABLE, s); }
+	void str(Symbol s) { symbol(AST_STRINGTABLE, s); }
+	void integer(Symbol s) { symbol(AST_INTTABLE, s); }
+	void type(Symbol s);
+
+	template <class Elem>
+	void list(AstKind kind, list_node<Elem>* l) {
+		for(int i = l->first(); l->more(i); i = l->next(i))
+			l->nth(i)->write_binary(*this);
+		word(kind);
+		word(l->len());
+	}
+	//A list of the count records just written.
+	void list(AstKind kind, int count) {
+		word(kind);
+		word(count);
+	}
+
+	//Adds the records of a part written with this writer's symbols.
+	void append(const AstWriter& part) {
+		words.insert(words.end(), part.words.begin(), part.words.end());
+	}
+	void add_id(Symbol s) { intern(AST_IDTABLE, s); }
+	void add_str(Symbol s) { intern(AST_STRINGTABLE, s); }
+	void add_int(Symbol s) { intern(AST_INTTABLE, s); }
+
+	//Words of the records written so far.
+	size_t size() const { return words.size(); }
+	//The whole file image (header, symbols, nodes) as words.
+	void image(std::vector<uint32_t>& out);
+	void write(std::ostream& out);
+};
+
+//true if COOL_BINARY_AST asks phases to write the binary form.
+bool ast_binary_requested();
+
+void write_binary_ast(Program p, std::ostream& out);
+
+//Looks at the first byte of f without consuming it.
+bool ast_input_is_binary(FILE* f);
+
+//Reads a whole binary AST from f; exits with a message if it is malformed.
+Program read_binary_ast(FILE* f);
+
+//Builds the AST of an image made by AstWriter::image.
+Program read_binary_ast(const std::vector<uint32_t>& image);
+
+//A fingerprint of the records of class c, taken while reading them, with
+//symbols by their text rather than their index and lines counted from the
+//first record of the class, so that it does not depend on the rest of the
+//file; 0 if c was not read from a binary AST.
+uint64_t read_class_fingerprint(tree_node* c);
+
+//The same fingerprint for any class: for one that was not read from a
+//binary AST, taken while its records are written, without keeping them.
+uint64_t class_records_fingerprint(Class_ c);
+
+#endif
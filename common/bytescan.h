@@ -0,0 +1,94 @@
+#ifndef BYTESCAN_H_
+#define BYTESCAN_H_
+
+//////////////////////////////////////////////////////////////////////
+//
+// Byte-class scanning
+//
+// The scanner spends most of its time in runs of bytes no rule cares
+// about: the body of a comment, a string literal or a stretch of white
+// space.  These helpers find the end of such a run 32 (AVX2) or 16
+// (SSE2) bytes at a time, and count the newlines in it on the way, so
+// the caller can step over the run in one go.  Without SSE2 they fall
+// back to a byte loop.
+//
+// set holds at most BYTESCAN_MAX_SET bytes.  No byte at or after end is
+// read.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#define BYTESCAN_MAX_SET 6
+
+//Bits of the bytes in one block that are in set (match) or not (!match).
+#if defined(__AVX2__)
+typedef __m256i bytescan_block;
+#define BYTESCAN_WIDTH 32
+static inline bytescan_block bytescan_load(const char* p) { return _mm256_loadu_si256((const __m256i*) p); }
+static inline unsigned bytescan_mask(bytescan_block b, const char* set, int n, bool match) {
+	__m256i hit = _mm256_setzero_si256();
+	for(int i = 0; i < n; i++)
+		hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(b, _mm256_set1_epi8(set[i])));
+	unsigned m = (unsigned) _mm256_movemask_epi8(hit);
+	return match ? m : ~m;
+}
+#elif defined(__SSE2__)
+typedef __m128i bytescan_block;
+#define BYTESCAN_WIDTH 16
+static inline bytescan_block bytescan_load(const char* p) { return _mm_loadu_si128((const __m128i*) p); }
+static inline unsigned bytescan_mask(bytescan_block b, const char* set, int n, bool match) {
+	__m128i hit = _mm_setzero_si128();
+	for(int i = 0; i < n; i++)
+		hit = _mm_or_si128(hit, _mm_cmpeq_epi8(b, _mm_set1_epi8(set[i])));
+	unsigned m = (unsigned) _mm_movemask_epi8(hit);
+	return (match ? m : ~m) & 0xffff;
+}
+#endif
+
+static inline bool bytescan_in(char c, const char* set, int n) {
+	for(int i = 0; i < n; i++)
+		if(c == set[i]) return true;
+	return false;
+}
+
+//First byte in [p, end) that is in set (match) or not in set (!match), or
+//end.  The newlines before it are added to newlines.
+static inline const char* bytescan(const char* p, const char* end, const char* set, int n,
+		bool match, int& newlines) {
+#ifdef BYTESCAN_WIDTH
+	const char nl = '\n';
+	while(end - p >= BYTESCAN_WIDTH) {
+		bytescan_block b = bytescan_load(p);
+		unsigned stop = bytescan_mask(b, set, n, match);
+		unsigned lines = bytescan_mask(b, &nl, 1, true);
+		if(stop != 0) {
+			int at = __builtin_ctz(stop);
+			newlines += __builtin_popcount(lines & ((1u << at) - 1));
+			return p + at;
+		}
+		newlines += __builtin_popcount(lines);
+		p += BYTESCAN_WIDTH;
+	}
+#endif
+	for(; p < end; p++) {
+		if(bytescan_in(*p, set, n) == match) return p;
+		if(*p == '\n') newlines++;
+	}
+	return end;
+}
+
+//First byte in [p, end) that is in set, or end.
+static inline const char* scan_to(const char* p, const char* end, const char* set, int n, int& newlines) {
+	return bytescan(p, end, set, n, true, newlines);
+}
+
+//First byte in [p, end) that is not in set, or end.
+static inline const char* scan_over(const char* p, const char* end, const char* set, int n, int& newlines) {
+	return bytescan(p, end, set, n, false, newlines);
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef FINGERPRINT_H_
+#define FINGERPRINT_H_
+
+//////////////////////////////////////////////////////////////////////
+//
+// Content fingerprints
+//
+// 64-bit FNV-1a, for the caches that decide whether something has to be
+// done again: it is fast and stable from run to run, which is all they
+// need; it is no defense against inputs made to collide.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FINGERPRINT_INIT 14695981039346656037ULL
+
+//Fingerprint of the n bytes at p, continuing from h.
+inline uint64_t fingerprint(const void* p, size_t n, uint64_t h = FINGERPRINT_INIT) {
+	const unsigned char* b = (const unsigned char*) p;
+	for(size_t i = 0; i < n; i++) {
+		h ^= b[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+#endif
@@ -0,0 +1,266 @@
+//////////////////////////////////////////////////////////////////////
+//
+// passes.cc
+//
+// Implementation of the pass instrumentation declared in passes.h.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <cstddef>
+#include <chrono>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+#include "passes.h"
+#include "arena.h"
+
+//////////////////////////////////////////////////////////////////////
+//
+// Allocation accounting
+//
+// Allocations are only counted when the report or the trace is asked
+// for; otherwise operator new and delete are malloc and free.  A counted
+// block carries a header with its size so that operator delete can keep
+// the count of live bytes.  The header is as large as the strictest
+// fundamental alignment so the user part stays aligned.
+//
+//////////////////////////////////////////////////////////////////////
+
+static int enabled = -1;		//-1: environment not read yet
+static bool report_requested = false;
+static const char* trace_file = NULL;
+
+//Reads the environment the first time.  It allocates nothing, so that
+//operator new can ask before the first allocation, which settles whether
+//blocks have a header for the rest of the run.
+static bool requested() {
+	if(enabled < 0) {
+		const char* report = getenv("COOL_TIME_PASSES");
+		report_requested = report != NULL && *report != '\0' && strcmp(report, "0") != 0;
+		trace_file = getenv("COOL_TRACE");
+		if(trace_file != NULL && *trace_file == '\0') trace_file = NULL;
+		enabled = report_requested || trace_file != NULL;
+	}
+	return enabled;
+}
+
+static const size_t HEADER = alignof(std::max_align_t);
+
+static std::atomic<long> alloc_count(0);	//allocations since start
+static std::atomic<long> alloc_bytes(0);	//bytes allocated since start
+static std::atomic<long> live_bytes(0);		//bytes currently allocated
+static std::atomic<long> peak_live(0);		//max of live_bytes since the innermost pass began
+
+void* operator new(size_t size) {
+	if(!requested()) {
+		void* p = malloc(size == 0 ? 1 : size);
+		if(p == NULL) throw std::bad_alloc();
+		return p;
+	}
+	void* p = malloc(size + HEADER);
+	if(p == NULL) throw std::bad_alloc();
+	*(size_t*) p = size;
+	alloc_count.fetch_add(1, std::memory_order_relaxed);
+	alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+	long live = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+	long peak = peak_live.load(std::memory_order_relaxed);
+	while(live > peak && !peak_live.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+		;
+	return (char*) p + HEADER;
+}
+
+void operator delete(void* p) noexcept {
+	if(p == NULL) return;
+	if(!enabled) {
+		free(p);
+		return;
+	}
+	char* block = (char*) p - HEADER;
+	live_bytes.fetch_sub(*(size_t*) block, std::memory_order_relaxed);
+	free(block);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Pass records
+//
+//////////////////////////////////////////////////////////////////////
+
+struct PassRecord {
+	std::string name;
+	int depth;			//nesting level, 0 for outermost passes
+	long start_us;		//wall clock at start, microseconds since the epoch
+	long dur_us;		//-1 while the pass is running
+	long allocs;		//at start: counter snapshot; at end: difference
+	long bytes;
+	long peak_heap;		//peak of live heap bytes during the pass
+	long saved_peak;	//peak of the enclosing pass when this one began
+	long max_rss_kb;	//process max RSS when the pass ended
+};
+
+struct Statistic {
+	std::string name;
+	long value;
+	long us;			//wall clock when last changed
+};
+
+static std::vector<PassRecord>* records = NULL;
+static std::vector<int>* open_passes = NULL;
+static std::vector<Statistic>* statistics = NULL;
+static std::map<std::string, size_t>* statistic_index = NULL;	//by name
+
+static long now_us() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static long max_rss_kb() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;		//kilobytes on Linux
+}
+
+static void finish(int index) {
+	PassRecord& r = (*records)[index];
+	r.dur_us = now_us() - r.start_us;
+	r.allocs = alloc_count.load() - r.allocs;
+	r.bytes = alloc_bytes.load() - r.bytes;
+	r.peak_heap = peak_live.load();
+	r.max_rss_kb = max_rss_kb();
+	//the enclosing pass saw everything this one saw
+	peak_live.store(r.saved_peak > r.peak_heap ? r.saved_peak : r.peak_heap);
+}
+
+static void print_report() {
+	fprintf(stderr, "===---------------------------------------------------------------------===\n");
+	fprintf(stderr, "                 Pass execution report (pid %d)\n", (int) getpid());
+	fprintf(stderr, "===---------------------------------------------------------------------===\n");
+	fprintf(stderr, "%10s %9s %12s %12s %11s  %s\n",
+			"Wall(ms)", "Allocs", "Alloc(KB)", "PeakHeap(KB)", "MaxRSS(KB)", "Pass");
+	for(size_t i = 0; i < records->size(); ++i) {
+		const PassRecord& r = (*records)[i];
+		fprintf(stderr, "%10.3f %9ld %12.1f %12.1f %11ld  %*s%s\n",
+				r.dur_us / 1000.0, r.allocs, r.bytes / 1024.0, r.peak_heap / 1024.0,
+				r.max_rss_kb, 2 * r.depth, "", r.name.c_str());
+	}
+	//arena objects do not show in the Allocs column
+	fprintf(stderr, "compile_arena: %ld objects, %.1f KB\n",
+			compile_arena.objects(), compile_arena.bytes() / 1024.0);
+	for(size_t i = 0; i < statistics->size(); ++i)
+		fprintf(stderr, "%10ld  %s\n", (*statistics)[i].value, (*statistics)[i].name.c_str());
+}
+
+//Append complete ("X") events.  The trace event format allows the closing
+//bracket of the array to be missing, which is what lets several processes
+//append to one file; the first writer opens the array.
+static void write_trace() {
+	int fd = open(trace_file, O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if(fd < 0) {
+		fprintf(stderr, "cannot open trace file %s\n", trace_file);
+		return;
+	}
+	flock(fd, LOCK_EX);
+	struct stat st;
+	std::string out;
+	if(fstat(fd, &st) == 0 && st.st_size == 0)
+		out += "[\n";
+	int pid = (int) getpid();
+	char buf[512];
+	for(size_t i = 0; i < records->size(); ++i) {
+		const PassRecord& r = (*records)[i];
+		snprintf(buf, sizeof(buf),
+				"{\"name\":\"%s\",\"cat\":\"pass\",\"ph\":\"X\",\"ts\":%ld,\"dur\":%ld,"
+				"\"pid\":%d,\"tid\":%d,\"args\":{\"allocs\":%ld,\"alloc_bytes\":%ld,"
+				"\"peak_heap_bytes\":%ld,\"max_rss_kb\":%ld}},\n",
+				r.name.c_str(), r.start_us, r.dur_us, pid, pid,
+				r.allocs, r.bytes, r.peak_heap, r.max_rss_kb);
+		out += buf;
+	}
+	for(size_t i = 0; i < statistics->size(); ++i) {
+		const Statistic& c = (*statistics)[i];
+		snprintf(buf, sizeof(buf),
+				"{\"name\":\"%s\",\"cat\":\"statistic\",\"ph\":\"C\",\"ts\":%ld,"
+				"\"pid\":%d,\"tid\":%d,\"args\":{\"value\":%ld}},\n",
+				c.name.c_str(), c.us, pid, pid, c.value);
+		out += buf;
+	}
+	if(write(fd, out.data(), out.size()) != (ssize_t) out.size())
+		fprintf(stderr, "short write to trace file %s\n", trace_file);
+	flock(fd, LOCK_UN);
+	close(fd);
+}
+
+//Runs at exit.  Phases leave through exit() on errors, so passes may still
+//be open; they are closed here so that the time up to the exit is kept.
+static void flush_passes() {
+	while(!open_passes->empty()) {
+		finish(open_passes->back());
+		open_passes->pop_back();
+	}
+	if(report_requested) print_report();
+	if(trace_file) write_trace();
+}
+
+bool passes_enabled() {
+	if(records == NULL && requested()) {
+		records = new std::vector<PassRecord>();
+		open_passes = new std::vector<int>();
+		statistics = new std::vector<Statistic>();
+		statistic_index = new std::map<std::string, size_t>();
+		atexit(flush_passes);
+	}
+	return enabled;
+}
+
+PassTimer::PassTimer(const char* name) : index(-1) {
+	if(!passes_enabled()) return;
+	PassRecord r;
+	r.name = name;
+	r.depth = open_passes->size();
+	r.dur_us = -1;
+	r.allocs = alloc_count.load();
+	r.bytes = alloc_bytes.load();
+	r.peak_heap = 0;
+	r.saved_peak = peak_live.load();
+	r.max_rss_kb = 0;
+	index = records->size();
+	records->push_back(r);
+	open_passes->push_back(index);
+	//the record itself is allocated before the pass starts counting
+	(*records)[index].allocs = alloc_count.load();
+	(*records)[index].bytes = alloc_bytes.load();
+	(*records)[index].start_us = now_us();
+	peak_live.store(live_bytes.load());
+}
+
+PassTimer::~PassTimer() {
+	if(index < 0) return;
+	finish(index);
+	open_passes->pop_back();
+}
+
+void pass_statistic(const char* name, long n) {
+	if(!passes_enabled()) return;
+	std::map<std::string, size_t>::iterator it = statistic_index->find(name);
+	if(it != statistic_index->end()) {
+		(*statistics)[it->second].value += n;
+		(*statistics)[it->second].us = now_us();
+		return;
+	}
+	(*statistic_index)[name] = statistics->size();
+	Statistic c;
+	c.name = name;
+	c.value = n;
+	c.us = now_us();
+	statistics->push_back(c);
+}
@@ -0,0 +1,48 @@
+#ifndef PASSES_H_
+#define PASSES_H_
+
+//////////////////////////////////////////////////////////////////////
+//
+// Pass instrumentation ("-time-passes")
+//
+// A PassTimer measures the scope it lives in: wall time, the number and
+// size of heap allocations made, the peak of live heap bytes and the
+// maximum resident set size of the process when the pass ends.  Passes
+// nest; the report indents inner passes under the enclosing one.
+//
+// Nothing is printed unless asked for through the environment:
+//
+//    COOL_TIME_PASSES=1      summary table on stderr when the phase exits
+//    COOL_TRACE=<file>       Chrome trace events appended to <file>
+//
+// Every phase of the pipeline (lexer | parser | semant | cgen) is its own
+// process; all of them append to the same trace file, each under its own
+// pid, so the file loads as one timeline in chrome://tracing or Perfetto.
+//
+// passes.cc replaces the global operator new/delete to count allocations
+// (only when the report or the trace is asked for; a run without them
+// pays nothing), so it has to be linked into every phase, together with
+// arena.cc.
+// Objects placed in compile_arena (arena.h) are not counted per pass;
+// the report ends with the arena's totals.
+//
+// A phase may also count what its passes did (pass_statistic); the counts
+// are listed after the passes, and are counter events in the trace.
+//
+//////////////////////////////////////////////////////////////////////
+
+class PassTimer {
+private:
+	int index;		//slot of this pass in the record table; -1 if disabled
+public:
+	PassTimer(const char* name);
+	~PassTimer();
+};
+
+//true if either the report or the trace was requested.
+bool passes_enabled();
+
+//Adds n to the statistic name, e.g. pass_statistic("cgen.void_checks_removed", 3).
+void pass_statistic(const char* name, long n);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef SYMBOL_SECTION_H_
+#define SYMBOL_SECTION_H_
+
+//////////////////////////////////////////////////////////////////////
+//
+// Symbol sections of the binary interchange files
+//
+// The binary AST (ast-binary.h) and the packed token stream (tokens.h)
+// carry their strings in the same way: a word with the length, then the
+// characters and a NUL, padded to a whole word.  The NUL lets a reader
+// hand the characters straight to StringTable::add_string.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+//Words taken by an entry of len characters.
+inline uint32_t symbol_entry_words(uint32_t len) {
+	return 1 + (len + 1 + 3) / 4;
+}
+
+inline void put_symbol_entry(std::vector<uint32_t>& out, const char* s, uint32_t len) {
+	size_t at = out.size();
+	out.resize(at + symbol_entry_words(len), 0);
+	out[at] = len;
+	memcpy(&out[at + 1], s, len);
+}
+
+//Characters of the entry at p, or NULL if it does not fit before end.
+inline char* get_symbol_entry(const uint32_t*& p, const uint32_t* end, uint32_t& len) {
+	if(p >= end) return NULL;
+	len = *p;
+	uint32_t n = symbol_entry_words(len);
+	if((size_t) (end - p) < n) return NULL;
+	char* s = (char*) (p + 1);
+	p += n;
+	return s;
+}
+
+#endif
@@ -0,0 +1,174 @@
+//////////////////////////////////////////////////////////////////////
+//
+// tokens.cc
+//
+// Writer (lexer side) and reader (parser side) of the packed token
+// stream described in tokens.h.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <string.h>
+#include "tokens.h"
+#include "symbol-section.h"
+
+//////////////////////////////////////////////////////////////////////
+//
+// Writing
+//
+//////////////////////////////////////////////////////////////////////
+
+uint32_t TokenWriter::intern(TokenTable table, Symbol s) {
+	std::map<Symbol, uint32_t>::iterator it = index[table].find(s);
+	if(it != index[table].end())
+		return it->second;
+	uint32_t i = symbols[table].size();
+	index[table][s] = i;
+	symbols[table].push_back(s);
+	return i;
+}
+
+void TokenWriter::begin(const char* filename) {
+	tokens.clear();
+	for(int t = 0; t < TOKEN_TEXT; t++) {
+		index[t].clear();
+		symbols[t].clear();
+	}
+	text.clear();
+	text.push_back(filename);
+}
+
+void TokenWriter::add(int token, int line, const YYSTYPE& value) {
+	PackedToken t;
+	t.head = token | (uint32_t) line << 9;
+	switch(token) {
+	case TYPEID:
+	case OBJECTID:
+		t.value = intern(TOKEN_IDTABLE, value.symbol);
+		break;
+	case STR_CONST:
+		t.value = intern(TOKEN_STRINGTABLE, value.symbol);
+		break;
+	case INT_CONST:
+		t.value = intern(TOKEN_INTTABLE, value.symbol);
+		break;
+	case BOOL_CONST:
+		t.value = value.boolean ? 1 : 0;
+		break;
+	case ERROR:
+		//the message may live in the scanner's buffer; keep a copy
+		t.value = text.size();
+		text.push_back(value.error_msg);
+		break;
+	default:
+		t.value = 0;
+	}
+	tokens.push_back(t);
+}
+
+void TokenWriter::write(FILE* out) {
+	std::vector<uint32_t> syms;
+	TokenHeader h;
+	memcpy(h.magic, TOKEN_MAGIC, sizeof(h.magic));
+	h.version = TOKEN_VERSION;
+	for(int t = 0; t < TOKEN_TEXT; t++) {
+		h.n_symbols[t] = symbols[t].size();
+		for(size_t i = 0; i < symbols[t].size(); i++)
+			put_symbol_entry(syms, symbols[t][i]->get_string(), symbols[t][i]->get_len());
+	}
+	h.n_symbols[TOKEN_TEXT] = text.size();
+	for(size_t i = 0; i < text.size(); i++)
+		put_symbol_entry(syms, text[i].data(), text[i].size());
+	h.symbol_words = syms.size();
+	h.n_tokens = tokens.size();
+	fwrite(&h, sizeof(h), 1, out);
+	fwrite(syms.data(), sizeof(uint32_t), syms.size(), out);
+	fwrite(tokens.data(), sizeof(PackedToken), tokens.size(), out);
+	//let the parser start on this file while the next one is scanned
+	fflush(out);
+}
+
+bool packed_tokens_requested() {
+	const char* v = getenv("COOL_PACKED_TOKENS");
+	return v != NULL && *v != '\0' && strcmp(v, "0") != 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Reading
+//
+//////////////////////////////////////////////////////////////////////
+
+bool token_input_is_packed(FILE* f) {
+	int c = getc(f);
+	if(c == EOF) return false;
+	ungetc(c, f);
+	return c == TOKEN_MAGIC[0];
+}
+
+static void malformed(const char* what) {
+	fprintf(stderr, "malformed packed token stream: %s\n", what);
+	exit(1);
+}
+
+//Reads the next section; false at the end of the input.
+bool TokenReader::read_section() {
+	TokenHeader h;
+	size_t n = fread(&h, 1, sizeof(h), in);
+	if(n == 0) return false;
+	if(n != sizeof(h)) malformed("truncated header");
+	if(memcmp(h.magic, TOKEN_MAGIC, sizeof(h.magic)) != 0) malformed("bad magic");
+	if(h.version != TOKEN_VERSION) malformed("unknown version");
+
+	std::vector<uint32_t> syms(h.symbol_words);
+	tokens.resize(h.n_tokens);
+	pos = 0;
+	if(fread(syms.data(), sizeof(uint32_t), syms.size(), in) != syms.size() ||
+			fread(tokens.data(), sizeof(PackedToken), tokens.size(), in) != tokens.size())
+		malformed("truncated section");
+
+	const uint32_t* p = syms.data();
+	const uint32_t* end = p + syms.size();
+	for(int t = 0; t < TOKEN_TABLES; t++) {
+		if(t < TOKEN_TEXT) symbols[t].clear();
+		else text.clear();
+		for(uint32_t i = 0; i < h.n_symbols[t]; i++) {
+			uint32_t len;
+			char* s = get_symbol_entry(p, end, len);
+			if(s == NULL) malformed("truncated symbol section");
+			switch(t) {
+			case TOKEN_IDTABLE: symbols[t].push_back(idtable.add_string(s, len)); break;
+			case TOKEN_STRINGTABLE: symbols[t].push_back(stringtable.add_string(s, len)); break;
+			case TOKEN_INTTABLE: symbols[t].push_back(inttable.add_string(s, len)); break;
+			default: text.push_back(strdup(s)); break;	//outlives the section
+			}
+		}
+	}
+	if(text.empty()) malformed("section without a file name");
+	return true;
+}
+
+int TokenReader::next(int& line, YYSTYPE& value) {
+	while(pos == tokens.size())
+		if(!read_section()) return 0;
+	const PackedToken& t = tokens[pos++];
+	int token = PACKED_KIND(t);
+	line = PACKED_LINE(t);
+	size_t table = TOKEN_TABLES;
+	switch(token) {
+	case TYPEID:
+	case OBJECTID: table = TOKEN_IDTABLE; break;
+	case STR_CONST: table = TOKEN_STRINGTABLE; break;
+	case INT_CONST: table = TOKEN_INTTABLE; break;
+	case BOOL_CONST: value.boolean = t.value != 0; break;
+	case ERROR:
+		if(t.value >= text.size()) malformed("message index out of range");
+		value.error_msg = text[t.value];
+		break;
+	}
+	if(table != TOKEN_TABLES) {
+		if(t.value >= symbols[table].size()) malformed("symbol index out of range");
+		value.symbol = symbols[table][t.value];
+	}
+	return token;
+}
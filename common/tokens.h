@@ -0,0 +1,105 @@
+#ifndef TOKENS_H_
+#define TOKENS_H_
+
+//////////////////////////////////////////////////////////////////////
+//
+// Packed token stream
+//
+// The text token stream of the lexer is one printed token per line that
+// the parser has to scan again.  In the packed form the lexer hands the
+// parser, for each source file, one section:
+//
+//    TokenHeader
+//    symbol section    idtable, stringtable and inttable entries used by
+//                      the tokens, then the text entries: the file name
+//                      and the messages of ERROR tokens
+//                      (layout in symbol-section.h)
+//    token array       n_tokens PackedTokens
+//
+// A PackedToken holds the token code and line in one word and its lexeme
+// in the other: the index of its symbol in the table for its kind, 0/1
+// for BOOL_CONST, the index of the message in the text table for ERROR.
+//
+// A section is written as soon as its file is scanned and the parser
+// reads sections one at a time, so when the phases run in a pipeline the
+// parser works on one file while the lexer scans the next.
+//
+// The lexer writes the packed form when COOL_PACKED_TOKENS is set; the
+// parser detects it by its first byte.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "stringtab.h"
+#include "cool-parse.h"
+
+#define TOKEN_MAGIC     "\177COOLTOK"
+#define TOKEN_VERSION   1
+
+struct PackedToken {
+	uint32_t head;		//token code (low 9 bits), line (the rest)
+	uint32_t value;
+};
+
+#define PACKED_KIND(t)  ((int) ((t).head & 0x1ff))
+#define PACKED_LINE(t)  ((int) ((t).head >> 9))
+
+enum TokenTable {
+	TOKEN_IDTABLE,
+	TOKEN_STRINGTABLE,
+	TOKEN_INTTABLE,
+	TOKEN_TEXT,				//entry 0 is the file name
+	TOKEN_TABLES
+};
+
+struct TokenHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t n_symbols[TOKEN_TABLES];
+	uint32_t symbol_words;
+	uint32_t n_tokens;
+};
+
+class TokenWriter {
+private:
+	std::vector<PackedToken> tokens;
+	std::map<Symbol, uint32_t> index[TOKEN_TEXT];
+	std::vector<Symbol> symbols[TOKEN_TEXT];
+	std::vector<std::string> text;
+
+	uint32_t intern(TokenTable table, Symbol s);
+public:
+	//Starts the section of filename.
+	void begin(const char* filename);
+	void add(int token, int line, const YYSTYPE& value);
+	void write(FILE* out);
+};
+
+class TokenReader {
+private:
+	FILE* in;
+	std::vector<PackedToken> tokens;
+	size_t pos;
+	std::vector<Symbol> symbols[TOKEN_TEXT];
+	std::vector<char*> text;
+
+	bool read_section();
+public:
+	TokenReader(FILE* f) : in(f), pos(0) { }
+	//Next token of the input, 0 at the end; sets line and value.
+	int next(int& line, YYSTYPE& value);
+	//Name of the file the last token came from.
+	char* filename() { return text.empty() ? NULL : text[0]; }
+};
+
+//true if COOL_PACKED_TOKENS asks the lexer for the packed form.
+bool packed_tokens_requested();
+
+//Looks at the first byte of f without consuming it.
+bool token_input_is_packed(FILE* f);
+
+#endif